@@ -0,0 +1,75 @@
+#ifndef EXAMPM_BENCHMARK_SYNTHETICPROBLEM_HPP
+#define EXAMPM_BENCHMARK_SYNTHETICPROBLEM_HPP
+
+#include <Cabana_Core.hpp>
+
+#include <Kokkos_Core.hpp>
+
+#include <limits>
+
+//---------------------------------------------------------------------------//
+// Synthetic problem setup. The fluid is a slab at rest filling the bottom
+// fraction of the domain in Z, with the entire X and Y extent filled. With a
+// partitioning in X and Y only, every rank holds the same number of
+// particles.
+struct SyntheticInitFunc
+{
+    double _z_fill;
+    double _volume;
+    double _mass;
+
+    SyntheticInitFunc( const double z_low, const double z_high,
+                       const double fill_fraction, const double cell_size,
+                       const int ppc, const double density )
+        : _z_fill( z_low + fill_fraction * ( z_high - z_low ) )
+        , _volume( cell_size * cell_size * cell_size / ( ppc * ppc * ppc ) )
+        , _mass( _volume * density )
+    {
+    }
+
+    // Particles are only created below the fill height.
+    Kokkos::Array<double, 6> boundingBox() const
+    {
+        double lo = std::numeric_limits<double>::lowest();
+        double hi = std::numeric_limits<double>::max();
+        return { lo, lo, lo, hi, hi, _z_fill };
+    }
+
+    template <class ParticleType>
+    KOKKOS_INLINE_FUNCTION bool operator()( const double x[3],
+                                            ParticleType& p ) const
+    {
+        if ( x[2] <= _z_fill )
+        {
+            // Affine matrix.
+            for ( int d0 = 0; d0 < 3; ++d0 )
+                for ( int d1 = 0; d1 < 3; ++d1 )
+                    Cabana::get<0>( p, d0, d1 ) = 0.0;
+
+            // Velocity
+            for ( int d = 0; d < 3; ++d )
+                Cabana::get<1>( p, d ) = 0.0;
+
+            // Position
+            for ( int d = 0; d < 3; ++d )
+                Cabana::get<2>( p, d ) = x[d];
+
+            // Mass
+            Cabana::get<3>( p ) = _mass;
+
+            // Volume
+            Cabana::get<4>( p ) = _volume;
+
+            // Deformation gradient determinant.
+            Cabana::get<5>( p ) = 1.0;
+
+            return true;
+        }
+
+        return false;
+    }
+};
+
+//---------------------------------------------------------------------------//
+
+#endif // EXAMPM_BENCHMARK_SYNTHETICPROBLEM_HPP
@@ -0,0 +1,396 @@
+#include "SyntheticProblem.hpp"
+
+#include <ExaMPM_BoundaryConditions.hpp>
+#include <ExaMPM_Mesh.hpp>
+#include <ExaMPM_ProblemManager.hpp>
+#include <ExaMPM_TimeIntegrator.hpp>
+#include <ExaMPM_Timer.hpp>
+#include <ExaMPM_Types.hpp>
+
+#include <Cabana_Core.hpp>
+
+#include <Cajita.hpp>
+
+#include <Kokkos_Core.hpp>
+
+#include <mpi.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+//---------------------------------------------------------------------------//
+// Benchmark parameters.
+struct BenchmarkParams
+{
+    int num_cell;
+    int ppc;
+    double fill_fraction;
+    bool random_order;
+    int num_run;
+};
+
+//---------------------------------------------------------------------------//
+// Particle storage layout of a run.
+struct ParticleLayout
+{
+    int vector_length;
+    bool split_position;
+    bool uniform_mass;
+    bool packed_position;
+};
+
+//---------------------------------------------------------------------------//
+// Minimum memory traffic of a kernel in doubles per particle, per ghosted
+// node and per ghosted cell. This assumes every field the kernel reads or
+// writes streams through memory exactly once and is used to compute an
+// effective bandwidth.
+struct TrafficModel
+{
+    double particle;
+    double node;
+    double cell;
+};
+
+//---------------------------------------------------------------------------//
+// Randomize the particle order. All synthetic particles are created at rest
+// with identical properties so permuting the positions is equivalent to
+// permuting the particles.
+template <class MemorySpace, class ExecutionSpace, class PositionSlice>
+void shuffleParticles( const ExecutionSpace& exec_space,
+                       const PositionSlice& x_p )
+{
+    ExaMPM::ParticleIndex num_p = x_p.size();
+
+    // Build the permutation on the host with a fixed seed.
+    std::vector<ExaMPM::ParticleIndex> perm( num_p );
+    std::iota( perm.begin(), perm.end(), 0 );
+    std::mt19937 generator( 1948 );
+    std::shuffle( perm.begin(), perm.end(), generator );
+    Kokkos::View<ExaMPM::ParticleIndex*, Kokkos::HostSpace,
+                 Kokkos::MemoryUnmanaged>
+        perm_host( perm.data(), num_p );
+    auto perm_view =
+        Kokkos::create_mirror_view_and_copy( MemorySpace(), perm_host );
+
+    // Permute.
+    Kokkos::View<double* [3], MemorySpace> x_copy(
+        Kokkos::ViewAllocateWithoutInitializing( "x_copy" ), num_p );
+    Kokkos::parallel_for(
+        "shuffle_copy",
+        ExaMPM::ParticleRangePolicy<ExecutionSpace>( exec_space, 0, num_p ),
+        KOKKOS_LAMBDA( const ExaMPM::ParticleIndex p ) {
+            for ( int d = 0; d < 3; ++d )
+                x_copy( p, d ) = x_p( p, d );
+        } );
+    Kokkos::parallel_for(
+        "shuffle_permute",
+        ExaMPM::ParticleRangePolicy<ExecutionSpace>( exec_space, 0, num_p ),
+        KOKKOS_LAMBDA( const ExaMPM::ParticleIndex p ) {
+            for ( int d = 0; d < 3; ++d )
+                x_p( perm_view( p ), d ) = x_copy( p, d );
+        } );
+    Kokkos::fence();
+}
+
+//---------------------------------------------------------------------------//
+// Time a kernel over a number of runs after a warm-up run. The time of each
+// run is the maximum over all ranks.
+template <class Function>
+std::string timeKernel( MPI_Comm comm, const std::string& backend,
+                        const std::string& kernel,
+                        const BenchmarkParams& params,
+                        const ParticleLayout& layout, const long num_particle,
+                        const long num_node, const long num_cell,
+                        const TrafficModel& traffic, const Function& function )
+{
+    function();
+    Kokkos::fence();
+
+    double total_time = 0.0;
+    double min_time = std::numeric_limits<double>::max();
+    Kokkos::Timer timer;
+    for ( int r = 0; r < params.num_run; ++r )
+    {
+        MPI_Barrier( comm );
+        timer.reset();
+        function();
+        Kokkos::fence();
+        double local_time = timer.seconds();
+        double run_time;
+        MPI_Allreduce( &local_time, &run_time, 1, MPI_DOUBLE, MPI_MAX, comm );
+        total_time += run_time;
+        min_time = std::min( min_time, run_time );
+    }
+    double avg_time = total_time / params.num_run;
+
+    double bytes = sizeof( double ) * ( traffic.particle * num_particle +
+                                        traffic.node * num_node +
+                                        traffic.cell * num_cell );
+
+    std::stringstream result;
+    result << "    { \"backend\": \"" << backend << "\", \"kernel\": \""
+           << kernel << "\", \"vector_length\": " << layout.vector_length
+           << ", \"split_position\": "
+           << ( layout.split_position ? "true" : "false" )
+           << ", \"uniform_mass\": "
+           << ( layout.uniform_mass ? "true" : "false" )
+           << ", \"packed_position\": "
+           << ( layout.packed_position ? "true" : "false" )
+           << ", \"num_particle\": " << num_particle
+           << ", \"num_node\": " << num_node << ", \"time_avg\": " << avg_time
+           << ", \"time_min\": " << min_time
+           << ", \"particles_per_second\": " << num_particle / avg_time
+           << ", \"bandwidth_gb_per_second\": " << 1.0e-9 * bytes / avg_time
+           << " }";
+    return result.str();
+}
+
+//---------------------------------------------------------------------------//
+// Run all kernel benchmarks for a backend and particle layout.
+template <class MemorySpace, class ExecutionSpace, int VectorLength,
+          bool SplitPosition, bool UniformMass, bool PackedPosition>
+void runLayout( MPI_Comm comm, const std::string& backend,
+                const BenchmarkParams& params,
+                std::vector<std::string>& results )
+{
+    ExecutionSpace exec_space;
+    ParticleLayout layout = { VectorLength, SplitPosition, UniformMass,
+                              PackedPosition };
+
+    // The domain is a unit box with walls on every side.
+    Kokkos::Array<double, 6> global_box = { 0.0, 0.0, 0.0, 1.0, 1.0, 1.0 };
+    double cell_size = 1.0 / params.num_cell;
+    std::array<int, 3> global_num_cell = { params.num_cell, params.num_cell,
+                                           params.num_cell };
+    std::array<bool, 3> periodic = { false, false, false };
+    Cajita::UniformDimPartitioner partitioner;
+    int halo_min = 3;
+    auto mesh = std::make_shared<ExaMPM::Mesh<MemorySpace>>(
+        global_box, global_num_cell, periodic, partitioner, halo_min,
+        halo_min, comm );
+
+    // Material properties.
+    double bulk_modulus = 1.0e5;
+    double density = 1.0e3;
+    double gamma = 7.0;
+    double kappa = 100.0;
+
+    // A small time step keeps the particle distribution nearly constant over
+    // the runs.
+    double delta_t = 1.0e-5;
+    double gravity = 9.81;
+
+    using problem_manager =
+        ExaMPM::ProblemManager<MemorySpace, VectorLength, SplitPosition,
+                               UniformMass, PackedPosition>;
+    problem_manager pm(
+        exec_space, mesh,
+        SyntheticInitFunc( 0.0, 1.0, params.fill_fraction, cell_size,
+                           params.ppc, density ),
+        params.ppc, bulk_modulus, density, gamma, kappa );
+
+    if ( params.random_order )
+        shuffleParticles<MemorySpace>(
+            exec_space,
+            pm.get( ExaMPM::Location::Particle(), ExaMPM::Field::Position() ) );
+
+    ExaMPM::BoundaryCondition bc;
+    for ( int d = 0; d < 6; ++d )
+        bc.boundary[d] = ExaMPM::BoundaryType::FREE_SLIP;
+    bc.min = mesh->minDomainGlobalNodeIndex();
+    bc.max = mesh->maxDomainGlobalNodeIndex();
+    ExaMPM::BoundaryNodeList<MemorySpace, ExaMPM::FreeSlipPolicy> bc_nodes(
+        exec_space, bc, *( mesh->localGrid() ) );
+
+    // Global entity counts.
+    long local_counts[3] = {
+        static_cast<long>( pm.numParticle() ),
+        static_cast<long>(
+            mesh->localGrid()
+                ->indexSpace( Cajita::Ghost(), Cajita::Node(), Cajita::Local() )
+                .size() ),
+        static_cast<long>(
+            mesh->localGrid()
+                ->indexSpace( Cajita::Ghost(), Cajita::Cell(), Cajita::Local() )
+                .size() ) };
+    long counts[3];
+    MPI_Allreduce( local_counts, counts, 3, MPI_LONG, MPI_SUM, comm );
+
+    // Doubles per particle of the stored position and of the mass.
+    double x_size = PackedPosition ? 1.5 : 3.0;
+    double m_size = UniformMass ? 0.0 : 1.0;
+
+    // Phase timers are required by the integrator but not reported here.
+    ExaMPM::Timer timer;
+
+    results.push_back( timeKernel(
+        comm, backend, "p2g", params, layout, counts[0], counts[1], counts[2],
+        { 13.0 + x_size + 2.0 * m_size, 7.0, 0.0 },
+        [&]() {
+            ExaMPM::TimeIntegrator::p2g( exec_space, pm, delta_t, timer );
+        } ) );
+
+    results.push_back( timeKernel(
+        comm, backend, "field_solve", params, layout, counts[0], counts[1],
+        counts[2], { 0.0, 10.0, 0.0 }, [&]() {
+            ExaMPM::TimeIntegrator::fieldSolve( exec_space, pm, delta_t,
+                                                gravity, bc_nodes, timer );
+        } ) );
+
+    results.push_back( timeKernel(
+        comm, backend, "g2p", params, layout, counts[0], counts[1], counts[2],
+        { 14.0 + 2.0 * x_size + m_size, 3.0, 2.0 }, [&]() {
+            ExaMPM::TimeIntegrator::g2p( exec_space, pm, delta_t, timer );
+        } ) );
+
+    results.push_back( timeKernel(
+        comm, backend, "correct_particle_positions", params, layout,
+        counts[0], counts[1], counts[2], { 2.0 * x_size, 6.0, 2.0 }, [&]() {
+            ExaMPM::TimeIntegrator::correctParticlePositions(
+                exec_space, pm, delta_t, bc_nodes, timer );
+        } ) );
+
+    results.push_back( timeKernel(
+        comm, backend, "communicate_particles", params, layout, counts[0],
+        counts[1], counts[2], { x_size, 0.0, 0.0 },
+        [&]() { pm.communicateParticles( halo_min ); } ) );
+}
+
+//---------------------------------------------------------------------------//
+// Sweep the particle vector lengths with the positions stored with the other
+// members and split into their own container. The uniform mass and packed
+// position storage are run with the default vector length.
+template <class MemorySpace, class ExecutionSpace>
+void runBackend( MPI_Comm comm, const std::string& backend,
+                 const BenchmarkParams& params,
+                 std::vector<std::string>& results )
+{
+    runLayout<MemorySpace, ExecutionSpace, 8, false, false, false>(
+        comm, backend, params, results );
+    runLayout<MemorySpace, ExecutionSpace, 16, false, false, false>(
+        comm, backend, params, results );
+    runLayout<MemorySpace, ExecutionSpace, 32, false, false, false>(
+        comm, backend, params, results );
+    runLayout<MemorySpace, ExecutionSpace, 64, false, false, false>(
+        comm, backend, params, results );
+    runLayout<MemorySpace, ExecutionSpace, 8, true, false, false>(
+        comm, backend, params, results );
+    runLayout<MemorySpace, ExecutionSpace, 16, true, false, false>(
+        comm, backend, params, results );
+    runLayout<MemorySpace, ExecutionSpace, 32, true, false, false>(
+        comm, backend, params, results );
+    runLayout<MemorySpace, ExecutionSpace, 64, true, false, false>(
+        comm, backend, params, results );
+
+    constexpr int default_length =
+        ExaMPM::DefaultVectorLength<MemorySpace>::value;
+    runLayout<MemorySpace, ExecutionSpace, default_length, false, true, false>(
+        comm, backend, params, results );
+    runLayout<MemorySpace, ExecutionSpace, default_length, true, true, false>(
+        comm, backend, params, results );
+    runLayout<MemorySpace, ExecutionSpace, default_length, true, false, true>(
+        comm, backend, params, results );
+}
+
+//---------------------------------------------------------------------------//
+int main( int argc, char* argv[] )
+{
+    MPI_Init( &argc, &argv );
+
+    Kokkos::initialize( argc, argv );
+
+    int comm_rank;
+    MPI_Comm_rank( MPI_COMM_WORLD, &comm_rank );
+    int comm_size;
+    MPI_Comm_size( MPI_COMM_WORLD, &comm_size );
+
+    if ( argc < 6 )
+    {
+        if ( 0 == comm_rank )
+            std::cerr << "Usage: " << argv[0]
+                      << " <cells per dim> <particles per cell dim>"
+                      << " <fill fraction> <sorted|random> <num runs>"
+                      << " [output json]" << std::endl;
+        Kokkos::finalize();
+        MPI_Finalize();
+        return 1;
+    }
+
+    BenchmarkParams params;
+
+    // number of cells in each dimension of the global grid
+    params.num_cell = std::atoi( argv[1] );
+
+    // particles per cell in a dimension
+    params.ppc = std::atoi( argv[2] );
+
+    // fraction of the domain filled with fluid
+    params.fill_fraction = std::atof( argv[3] );
+
+    // particle ordering
+    std::string ordering( argv[4] );
+    params.random_order = ( 0 == ordering.compare( "random" ) );
+
+    // number of timed runs of each kernel
+    params.num_run = std::atoi( argv[5] );
+
+    // output file (stdout if not given)
+    std::string output_file = ( argc > 6 ) ? argv[6] : "";
+
+    // run the benchmarks on each enabled host backend.
+    std::vector<std::string> results;
+#ifdef KOKKOS_ENABLE_SERIAL
+    runBackend<Kokkos::HostSpace, Kokkos::Serial>( MPI_COMM_WORLD, "serial",
+                                                   params, results );
+#endif
+#ifdef KOKKOS_ENABLE_OPENMP
+    runBackend<Kokkos::HostSpace, Kokkos::OpenMP>( MPI_COMM_WORLD, "openmp",
+                                                   params, results );
+#endif
+
+    // write the report.
+    if ( 0 == comm_rank )
+    {
+        std::stringstream json;
+        json << "{\n"
+             << "  \"num_rank\": " << comm_size << ",\n"
+             << "  \"num_cell\": " << params.num_cell << ",\n"
+             << "  \"ppc\": " << params.ppc << ",\n"
+             << "  \"fill_fraction\": " << params.fill_fraction << ",\n"
+             << "  \"ordering\": \""
+             << ( params.random_order ? "random" : "sorted" ) << "\",\n"
+             << "  \"num_run\": " << params.num_run << ",\n"
+             << "  \"results\": [\n";
+        for ( std::size_t r = 0; r < results.size(); ++r )
+            json << results[r] << ( ( r + 1 < results.size() ) ? ",\n" : "\n" );
+        json << "  ]\n}\n";
+
+        if ( output_file.empty() )
+        {
+            std::cout << json.str();
+        }
+        else
+        {
+            std::ofstream file( output_file );
+            file << json.str();
+        }
+    }
+
+    Kokkos::finalize();
+
+    MPI_Finalize();
+
+    return 0;
+}
+
+//---------------------------------------------------------------------------//
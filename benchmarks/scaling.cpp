@@ -0,0 +1,193 @@
+#include "SyntheticProblem.hpp"
+
+#include <ExaMPM_BoundaryConditions.hpp>
+#include <ExaMPM_Solver.hpp>
+#include <ExaMPM_SolverOptions.hpp>
+#include <ExaMPM_Timer.hpp>
+
+#include <Cabana_Core.hpp>
+
+#include <Cajita.hpp>
+
+#include <Kokkos_Core.hpp>
+
+#include <mpi.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+//---------------------------------------------------------------------------//
+// Weak and strong scaling driver. The fluid is a slab at rest filling the
+// bottom fraction of a walled box and the ranks are partitioned in X and Y
+// only, so every rank carries the same load.
+//
+// Weak scaling: every rank owns a fixed block of cells and the domain grows
+// with the number of ranks.
+//
+// Strong scaling: the global grid is fixed and divided among the ranks.
+//
+// The driver runs with local oversubscription for quick studies on a single
+// box, e.g.:
+//
+//   mpirun --oversubscribe -np 8 ./ScalingDriver weak 32 2 0.5 20 serial
+//
+void scaling( const bool weak, const int num_cell, const int ppc,
+              const double fill_fraction, const int num_step,
+              const std::string& device, const std::string& output_file,
+              const bool redundant_ghost_solve )
+{
+    int comm_rank;
+    MPI_Comm_rank( MPI_COMM_WORLD, &comm_rank );
+    int comm_size;
+    MPI_Comm_size( MPI_COMM_WORLD, &comm_size );
+
+    // Partition in X and Y.
+    std::array<int, 3> ranks_per_dim = { 0, 0, 1 };
+    MPI_Dims_create( comm_size, 2, ranks_per_dim.data() );
+    Cajita::ManualPartitioner partitioner( ranks_per_dim );
+
+    // In weak scaling each rank owns a unit cube of num_cell^3 cells. In
+    // strong scaling the global grid has num_cell^3 cells on a unit cube.
+    double cell_size = 1.0 / num_cell;
+    std::array<int, 3> global_num_cell = { num_cell, num_cell, num_cell };
+    if ( weak )
+    {
+        global_num_cell[0] *= ranks_per_dim[0];
+        global_num_cell[1] *= ranks_per_dim[1];
+    }
+    Kokkos::Array<double, 6> global_box = {
+        0.0, 0.0, 0.0, global_num_cell[0] * cell_size,
+        global_num_cell[1] * cell_size, global_num_cell[2] * cell_size };
+
+    // Walls everywhere.
+    std::array<bool, 3> periodic = { false, false, false };
+    ExaMPM::BoundaryCondition bc;
+    for ( int d = 0; d < 6; ++d )
+        bc.boundary[d] = ExaMPM::BoundaryType::FREE_SLIP;
+
+    // Material properties.
+    double bulk_modulus = 1.0e5;
+    double density = 1.0e3;
+    double gamma = 7.0;
+    double kappa = 100.0;
+    double gravity = 9.81;
+
+    // Time step.
+    double delta_t = 1.0e-4;
+    double t_final = num_step * delta_t;
+    int halo_size = 3;
+
+    // Solver options.
+    ExaMPM::SolverOptions options;
+    options.redundant_ghost_solve = redundant_ghost_solve;
+
+    // Run the problem without particle output or diagnostics.
+    auto solver = ExaMPM::createSolver<ExaMPM::FreeSlipPolicy>(
+        device, MPI_COMM_WORLD, global_box, global_num_cell, periodic,
+        partitioner, halo_size,
+        SyntheticInitFunc( global_box[2], global_box[5], fill_fraction,
+                           cell_size, ppc, density ),
+        ppc, bulk_modulus, density, gamma, kappa, delta_t, gravity, bc,
+        options );
+    solver->timer().setFence( true );
+    solver->solve( t_final, 0, 0 );
+
+    // Append the per-phase timings for this rank count.
+    std::array<double, ExaMPM::Phase::NUM_PHASE> min_seconds;
+    std::array<double, ExaMPM::Phase::NUM_PHASE> avg_seconds;
+    std::array<double, ExaMPM::Phase::NUM_PHASE> max_seconds;
+    solver->timer().reduce( MPI_COMM_WORLD, min_seconds, avg_seconds,
+                            max_seconds );
+    long num_step_run = solver->timer().count( ExaMPM::Phase::TOTAL );
+    long num_particle =
+        solver->timer().globalParticleUpdates( MPI_COMM_WORLD ) /
+        std::max( num_step_run, 1L );
+
+    if ( 0 == comm_rank )
+    {
+        std::ifstream existing( output_file );
+        bool write_header = !existing.good();
+        existing.close();
+
+        std::ofstream file( output_file, std::ios::app );
+        if ( write_header )
+            file << "mode,redundant_ghost_solve,num_rank,num_cell_x,"
+                 << "num_cell_y,num_cell_z,num_particle,num_step,phase,min,"
+                 << "avg,max\n";
+        for ( int p = 0; p < ExaMPM::Phase::NUM_PHASE; ++p )
+            file << ( weak ? "weak" : "strong" ) << ","
+                 << redundant_ghost_solve << "," << comm_size << ","
+                 << global_num_cell[0] << "," << global_num_cell[1] << ","
+                 << global_num_cell[2] << "," << num_particle << ","
+                 << num_step_run << "," << ExaMPM::Phase::name( p ) << ","
+                 << min_seconds[p] << "," << avg_seconds[p] << ","
+                 << max_seconds[p] << "\n";
+    }
+}
+
+//---------------------------------------------------------------------------//
+int main( int argc, char* argv[] )
+{
+    MPI_Init( &argc, &argv );
+
+    Kokkos::initialize( argc, argv );
+
+    int comm_rank;
+    MPI_Comm_rank( MPI_COMM_WORLD, &comm_rank );
+
+    if ( argc < 7 )
+    {
+        if ( 0 == comm_rank )
+            std::cerr << "Usage: " << argv[0]
+                      << " <weak|strong> <cells per dim>"
+                      << " <particles per cell dim> <fill fraction>"
+                      << " <num steps> <device> [output csv]"
+                      << " [redundant ghost solve]"
+                      << std::endl;
+        Kokkos::finalize();
+        MPI_Finalize();
+        return 1;
+    }
+
+    // scaling mode
+    std::string mode( argv[1] );
+    bool weak = ( 0 == mode.compare( "weak" ) );
+
+    // cells per dimension (per rank in weak scaling, global in strong
+    // scaling)
+    int num_cell = std::atoi( argv[2] );
+
+    // particles per cell in a dimension
+    int ppc = std::atoi( argv[3] );
+
+    // fraction of the domain filled with fluid
+    double fill_fraction = std::atof( argv[4] );
+
+    // number of time steps
+    int num_step = std::atoi( argv[5] );
+
+    // device type
+    std::string device( argv[6] );
+
+    // output file
+    std::string output_file = ( argc > 7 ) ? argv[7] : "scaling.csv";
+
+    // compute ghost velocities redundantly (optional, 0 or 1)
+    bool redundant_ghost_solve = ( argc > 8 ) ? std::atoi( argv[8] ) : false;
+
+    // run the problem.
+    scaling( weak, num_cell, ppc, fill_fraction, num_step, device,
+             output_file, redundant_ghost_solve );
+
+    Kokkos::finalize();
+
+    MPI_Finalize();
+
+    return 0;
+}
+
+//---------------------------------------------------------------------------//
@@ -0,0 +1,70 @@
+#ifndef EXAMPM_EXAMPLE_EXAMPLEOPTIONS_HPP
+#define EXAMPM_EXAMPLE_EXAMPLEOPTIONS_HPP
+
+#include <ExaMPM_SolverOptions.hpp>
+
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+
+//---------------------------------------------------------------------------//
+// Run options shared by the examples. They are given as named arguments
+// after the positional arguments of an example:
+//
+//   --diagnostic-freq=N       write diagnostics every N steps
+//   --diagnostic-file=NAME    file the diagnostics are written to
+//   --fence-timers            fence the execution space around timed phases
+//   --uniform-mass            store one mass and volume for all particles
+//   --split-positions         store the positions apart from the other
+//                             particle members
+//   --packed-positions        store the positions in the packed format
+//   --numa-first-touch        place the particles and grid with first
+//                             touch. Use with OMP_PROC_BIND and OMP_PLACES
+//   --autotune                tune the kernel launch parameters over the
+//                             first steps and cache them
+struct ExampleOptions
+{
+    int diagnostic_freq = 0;
+    bool fence_timers = false;
+    ExaMPM::SolverOptions solver;
+};
+
+//---------------------------------------------------------------------------//
+// Parse the named arguments starting at first_arg. Unknown arguments throw.
+inline ExampleOptions parseExampleOptions( const int argc, char* argv[],
+                                           const int first_arg,
+                                           const std::string& example )
+{
+    ExampleOptions options;
+    for ( int n = first_arg; n < argc; ++n )
+    {
+        std::string arg( argv[n] );
+        std::string freq_flag = "--diagnostic-freq=";
+        std::string file_flag = "--diagnostic-file=";
+        if ( 0 == arg.compare( 0, freq_flag.size(), freq_flag ) )
+            options.diagnostic_freq =
+                std::atoi( arg.substr( freq_flag.size() ).c_str() );
+        else if ( 0 == arg.compare( 0, file_flag.size(), file_flag ) )
+            options.solver.diagnostic_file = arg.substr( file_flag.size() );
+        else if ( "--fence-timers" == arg )
+            options.fence_timers = true;
+        else if ( "--uniform-mass" == arg )
+            options.solver.uniform_particle_mass = true;
+        else if ( "--split-positions" == arg )
+            options.solver.split_particle_position = true;
+        else if ( "--packed-positions" == arg )
+            options.solver.packed_particle_position = true;
+        else if ( "--numa-first-touch" == arg )
+            options.solver.numa_first_touch = true;
+        else if ( "--autotune" == arg )
+            options.solver.autotune_kernels = true;
+        else
+            throw std::runtime_error( "Unknown " + example +
+                                      " option: " + arg );
+    }
+    return options;
+}
+
+//---------------------------------------------------------------------------//
+
+#endif // EXAMPM_EXAMPLE_EXAMPLEOPTIONS_HPP
@@ -1,3 +1,5 @@
+#include "ExampleOptions.hpp"
+
 #include <ExaMPM_BoundaryConditions.hpp>
 #include <ExaMPM_Solver.hpp>
 
@@ -11,6 +13,8 @@
 
 #include <array>
 #include <cmath>
+#include <cstdlib>
+#include <string>
 
 //---------------------------------------------------------------------------//
 // Create the problem setup. The initial geometry is a static water column
@@ -27,6 +31,12 @@ struct ParticleInitFunc
     {
     }
 
+    // Particles are only created in the water column.
+    Kokkos::Array<double, 6> boundingBox() const
+    {
+        return { 0.0, 0.0, 0.0, 0.4, 0.4, 0.6 };
+    }
+
     template <class ParticleType>
     KOKKOS_INLINE_FUNCTION bool operator()( const double x[3],
                                             ParticleType& p ) const
@@ -66,7 +76,7 @@ struct ParticleInitFunc
 //---------------------------------------------------------------------------//
 void damBreak( const double cell_size, const int ppc, const int halo_size,
                const double delta_t, const double t_final, const int write_freq,
-               const std::string& device )
+               const ExampleOptions& options, const std::string& device )
 {
     // The dam break domain is in a box on [0,1] in each dimension.
     Kokkos::Array<double, 6> global_box = { 0.0, 0.0, 0.0, 1.0, 1.0, 1.0 };
@@ -108,11 +118,13 @@ void damBreak( const double cell_size, const int ppc, const int halo_size,
     bc.boundary[5] = ExaMPM::BoundaryType::FREE_SLIP;
 
     // Solve the problem.
-    auto solver = ExaMPM::createSolver(
+    auto solver = ExaMPM::createSolver<ExaMPM::FreeSlipPolicy>(
         device, MPI_COMM_WORLD, global_box, global_num_cell, periodic,
         partitioner, halo_size, ParticleInitFunc( cell_size, ppc, density ),
-        ppc, bulk_modulus, density, gamma, kappa, delta_t, gravity, bc );
-    solver->solve( t_final, write_freq );
+        ppc, bulk_modulus, density, gamma, kappa, delta_t, gravity, bc,
+        options.solver );
+    solver->timer().setFence( options.fence_timers );
+    solver->solve( t_final, write_freq, options.diagnostic_freq );
 }
 
 //---------------------------------------------------------------------------//
@@ -143,8 +155,12 @@ int main( int argc, char* argv[] )
     // device type
     std::string device( argv[7] );
 
+    // Optional named arguments follow the device. See ExampleOptions.hpp.
+    auto options = parseExampleOptions( argc, argv, 8, "dam break" );
+
     // run the problem.
-    damBreak( cell_size, ppc, halo_size, delta_t, t_final, write_freq, device );
+    damBreak( cell_size, ppc, halo_size, delta_t, t_final, write_freq, options,
+              device );
 
     Kokkos::finalize();
 
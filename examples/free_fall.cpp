@@ -1,3 +1,5 @@
+#include "ExampleOptions.hpp"
+
 #include <ExaMPM_BoundaryConditions.hpp>
 #include <ExaMPM_Solver.hpp>
 
@@ -27,6 +29,12 @@ struct ParticleInitFunc
     {
     }
 
+    // Particles are only created in the sphere.
+    Kokkos::Array<double, 6> boundingBox() const
+    {
+        return { -0.25, -0.25, -0.25, 0.25, 0.25, 0.25 };
+    }
+
     template <class ParticleType>
     KOKKOS_INLINE_FUNCTION bool operator()( const double x[3],
                                             ParticleType& p ) const
@@ -65,7 +73,7 @@ struct ParticleInitFunc
 //---------------------------------------------------------------------------//
 void freeFall( const double cell_size, const int ppc, const int halo_size,
                const double delta_t, const double t_final, const int write_freq,
-               const std::string& device )
+               const ExampleOptions& options, const std::string& device )
 {
     // The dam break domain is in a box on [0,1] in each dimension.
     Kokkos::Array<double, 6> global_box = { -0.5, -0.5, -0.5, 0.5, 0.5, 0.5 };
@@ -107,11 +115,13 @@ void freeFall( const double cell_size, const int ppc, const int halo_size,
     bc.boundary[5] = ExaMPM::BoundaryType::NONE;
 
     // Solve the problem.
-    auto solver = ExaMPM::createSolver(
+    auto solver = ExaMPM::createSolver<ExaMPM::NoBoundaryPolicy>(
         device, MPI_COMM_WORLD, global_box, global_num_cell, periodic,
         partitioner, halo_size, ParticleInitFunc( cell_size, ppc, density ),
-        ppc, bulk_modulus, density, gamma, kappa, delta_t, gravity, bc );
-    solver->solve( t_final, write_freq );
+        ppc, bulk_modulus, density, gamma, kappa, delta_t, gravity, bc,
+        options.solver );
+    solver->timer().setFence( options.fence_timers );
+    solver->solve( t_final, write_freq, options.diagnostic_freq );
 }
 
 //---------------------------------------------------------------------------//
@@ -142,8 +152,12 @@ int main( int argc, char* argv[] )
     // device type
     std::string device( argv[7] );
 
+    // Optional named arguments follow the device. See ExampleOptions.hpp.
+    auto options = parseExampleOptions( argc, argv, 8, "free fall" );
+
     // run the problem.
-    freeFall( cell_size, ppc, halo_size, delta_t, t_final, write_freq, device );
+    freeFall( cell_size, ppc, halo_size, delta_t, t_final, write_freq, options,
+              device );
 
     Kokkos::finalize();
 
@@ -0,0 +1,190 @@
+#include "ExampleOptions.hpp"
+
+#include <ExaMPM_BoundaryConditions.hpp>
+#include <ExaMPM_Solver.hpp>
+#include <ExaMPM_VoxelGeometry.hpp>
+
+#include <Cabana_Core.hpp>
+
+#include <Cajita.hpp>
+
+#include <Kokkos_Core.hpp>
+
+#include <mpi.h>
+
+#include <array>
+#include <cmath>
+#include <string>
+
+//---------------------------------------------------------------------------//
+// Create particles at rest inside of a voxelized geometry. This functor is
+// bound to each rank and only holds the block of the geometry covering the
+// rank's owned cells.
+template <class MemorySpace>
+struct BoundVoxelInitFunc
+{
+    ExaMPM::VoxelMask<MemorySpace> _mask;
+    double _volume;
+    double _mass;
+
+    // Particles are only created in the occupied voxels of the block.
+    Kokkos::Array<double, 6> boundingBox() const
+    {
+        return _mask.boundingBox();
+    }
+
+    template <class ParticleType>
+    KOKKOS_INLINE_FUNCTION bool operator()( const double x[3],
+                                            ParticleType& p ) const
+    {
+        if ( _mask.inside( x ) )
+        {
+            // Affine matrix.
+            for ( int d0 = 0; d0 < 3; ++d0 )
+                for ( int d1 = 0; d1 < 3; ++d1 )
+                    Cabana::get<0>( p, d0, d1 ) = 0.0;
+
+            // Velocity
+            for ( int d = 0; d < 3; ++d )
+                Cabana::get<1>( p, d ) = 0.0;
+
+            // Position
+            for ( int d = 0; d < 3; ++d )
+                Cabana::get<2>( p, d ) = x[d];
+
+            // Mass
+            Cabana::get<3>( p ) = _mass;
+
+            // Volume
+            Cabana::get<4>( p ) = _volume;
+
+            // Deformation gradient determinant.
+            Cabana::get<5>( p ) = 1.0;
+
+            return true;
+        }
+
+        return false;
+    }
+};
+
+//---------------------------------------------------------------------------//
+// Problem setup. The geometry is read from a voxel file when the particles
+// are initialized.
+struct VoxelInitFunc
+{
+    ExaMPM::VoxelGeometry _geometry;
+    double _volume;
+    double _mass;
+
+    VoxelInitFunc( const std::string& voxel_file, const double cell_size,
+                   const int ppc, const double density )
+        : _geometry( voxel_file )
+        , _volume( cell_size * cell_size * cell_size / ( ppc * ppc * ppc ) )
+        , _mass( _volume * density )
+    {
+    }
+
+    // Load the block of the geometry covering the owned cells of this rank.
+    template <class MemorySpace, class LocalGridType>
+    BoundVoxelInitFunc<MemorySpace>
+    bind( const LocalGridType& local_grid ) const
+    {
+        return { _geometry.load<MemorySpace>( local_grid ), _volume, _mass };
+    }
+};
+
+//---------------------------------------------------------------------------//
+void voxelInit( const std::string& voxel_file, const double cell_size,
+                const int ppc, const int halo_size, const double delta_t,
+                const double t_final, const int write_freq,
+                const ExampleOptions& options, const std::string& device )
+{
+    // The domain is a box on [0,1] in each dimension. The geometry is placed
+    // in the domain by the low corner and spacing of the voxel file.
+    Kokkos::Array<double, 6> global_box = { 0.0, 0.0, 0.0, 1.0, 1.0, 1.0 };
+
+    // Compute the number of cells in each direction. The user input must
+    // squarely divide the domain.
+    std::array<int, 3> global_num_cell = {
+        static_cast<int>( 1.0 / cell_size ),
+        static_cast<int>( 1.0 / cell_size ),
+        static_cast<int>( 1.0 / cell_size ) };
+
+    // Walls everywhere.
+    std::array<bool, 3> periodic = { false, false, false };
+
+    // Partition in all dimensions.
+    Cajita::UniformDimPartitioner partitioner;
+
+    // Material properties.
+    double bulk_modulus = 1.0e5;
+    double density = 1.0e3;
+    double gamma = 7.0;
+    double kappa = 100.0;
+
+    // Gravity pulls down in z.
+    double gravity = 9.81;
+
+    // Free slip conditions on all faces.
+    ExaMPM::BoundaryCondition bc;
+    for ( int d = 0; d < 6; ++d )
+        bc.boundary[d] = ExaMPM::BoundaryType::FREE_SLIP;
+
+    // Solve the problem.
+    auto solver = ExaMPM::createSolver<ExaMPM::FreeSlipPolicy>(
+        device, MPI_COMM_WORLD, global_box, global_num_cell, periodic,
+        partitioner, halo_size,
+        VoxelInitFunc( voxel_file, cell_size, ppc, density ), ppc,
+        bulk_modulus, density, gamma, kappa, delta_t, gravity, bc,
+        options.solver );
+    solver->timer().setFence( options.fence_timers );
+    solver->solve( t_final, write_freq, options.diagnostic_freq );
+}
+
+//---------------------------------------------------------------------------//
+int main( int argc, char* argv[] )
+{
+    MPI_Init( &argc, &argv );
+
+    Kokkos::initialize( argc, argv );
+
+    // voxel geometry file
+    std::string voxel_file( argv[1] );
+
+    // cell size
+    double cell_size = std::atof( argv[2] );
+
+    // particles per cell in a dimension
+    int ppc = std::atoi( argv[3] );
+
+    // number of halo cells.
+    int halo_size = std::atoi( argv[4] );
+
+    // time step size.
+    double delta_t = std::atof( argv[5] );
+
+    // end time.
+    double t_final = std::atof( argv[6] );
+
+    // write frequency
+    int write_freq = std::atoi( argv[7] );
+
+    // device type
+    std::string device( argv[8] );
+
+    // Optional named arguments follow the device. See ExampleOptions.hpp.
+    auto options = parseExampleOptions( argc, argv, 9, "voxel init" );
+
+    // run the problem.
+    voxelInit( voxel_file, cell_size, ppc, halo_size, delta_t, t_final,
+               write_freq, options, device );
+
+    Kokkos::finalize();
+
+    MPI_Finalize();
+
+    return 0;
+}
+
+//---------------------------------------------------------------------------//
@@ -0,0 +1,340 @@
+/****************************************************************************
+ * Copyright (c) 2018-2020 by the ExaMPM authors                            *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the ExaMPM library. ExaMPM is distributed under a   *
+ * BSD 3-clause license. For the licensing terms see the LICENSE file in    *
+ * the top-level directory.                                                 *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#ifndef EXAMPM_AUTOTUNE_HPP
+#define EXAMPM_AUTOTUNE_HPP
+
+#include <ExaMPM_SolverOptions.hpp>
+
+#include <Cajita.hpp>
+
+#include <Kokkos_Core.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <mpi.h>
+
+#include <unistd.h>
+
+namespace ExaMPM
+{
+//---------------------------------------------------------------------------//
+/*!
+  \class Autotuner
+  \brief Selects launch parameters of the grid and particle kernels by
+  timing.
+
+  Each tuned launch is bracketed by start() and stop(). While a kernel is
+  being tuned every launch uses the next candidate and is timed between
+  fences. After each candidate has run the requested number of trials the
+  fastest one is used for the rest of the run. Kernels are keyed by the
+  execution space, the kernel label, and the local grid extent or the
+  power of two bucket of the local particle count they run over.
+
+  The choices are read from and saved to a cache file with one entry per
+  line so later runs on the same host and problem size start tuned. When
+  tuning is disabled start() always returns the default candidate 0.
+
+  Tuning is also disabled with NUMA first touch. The tuned tiles and chunk
+  sizes map the indices to threads differently from the default policies
+  the arrays were first touched with, which would bring back the remote
+  memory traffic first touch removes.
+*/
+class Autotuner
+{
+  public:
+    // MDRange tile candidates. Candidate 0 is the Kokkos default.
+    static constexpr int num_tile = 6;
+
+    // Range policy chunk size candidates. Candidate 0 is the Kokkos default.
+    static constexpr int num_chunk = 5;
+
+    Autotuner( const SolverOptions& options, MPI_Comm comm )
+        : _enabled( options.autotune_kernels && !options.numa_first_touch )
+        , _trials( std::max( options.autotune_trials, 1 ) )
+        , _cache_file( options.autotune_cache_file )
+        , _comm( comm )
+        , _finished( !_enabled )
+        , _active( nullptr )
+        , _active_candidate( 0 )
+    {
+        char host[256] = "unknown";
+        gethostname( host, sizeof( host ) - 1 );
+        _host = host;
+
+        if ( _enabled && !_cache_file.empty() )
+            loadCache();
+    }
+
+    // Tile shape of an MDRange candidate.
+    static Kokkos::Array<int, 3> tile( const int candidate )
+    {
+        const int tiles[num_tile][3] = { { 0, 0, 0 },  { 1, 1, 64 },
+                                         { 1, 4, 32 }, { 1, 8, 32 },
+                                         { 2, 4, 32 }, { 4, 4, 16 } };
+        return { tiles[candidate][0], tiles[candidate][1],
+                 tiles[candidate][2] };
+    }
+
+    // Chunk size of a range policy candidate. Zero is the Kokkos default.
+    static int chunkSize( const int candidate )
+    {
+        const int chunks[num_chunk] = { 0, 16, 64, 256, 1024 };
+        return chunks[candidate];
+    }
+
+    // Start a launch of a kernel over a local index space and return the
+    // candidate to launch it with.
+    template <class ExecutionSpace>
+    int start( const ExecutionSpace& exec_space, const std::string& kernel,
+               const Cajita::IndexSpace<3>& space, const int num_candidate )
+    {
+        return startKey( exec_space,
+                         kernel + " " + std::to_string( space.extent( 0 ) ) +
+                             " " + std::to_string( space.extent( 1 ) ) +
+                             " " + std::to_string( space.extent( 2 ) ),
+                         num_candidate );
+    }
+
+    // Start a launch of a kernel over the local particles and return the
+    // candidate to launch it with. The particle count changes with every
+    // migration so the kernel is keyed by the power of two below the count.
+    template <class ExecutionSpace>
+    int start( const ExecutionSpace& exec_space, const std::string& kernel,
+               const std::size_t num_particle, const int num_candidate )
+    {
+        int bucket = 0;
+        while ( ( num_particle >> ( bucket + 1 ) ) > 0 )
+            ++bucket;
+        return startKey( exec_space,
+                         kernel + " particles 2^" + std::to_string( bucket ),
+                         num_candidate );
+    }
+
+    // Finish a launch started with start().
+    template <class ExecutionSpace>
+    void stop( const ExecutionSpace& exec_space )
+    {
+        if ( nullptr == _active )
+            return;
+
+        exec_space.fence();
+        auto& record = *_active;
+        _active = nullptr;
+        record.times[_active_candidate] =
+            std::min( record.times[_active_candidate], _timer.seconds() );
+
+        int num_candidate = record.times.size();
+        if ( ++record.count == num_candidate * _trials )
+        {
+            record.choice = std::min_element( record.times.begin(),
+                                              record.times.end() ) -
+                            record.times.begin();
+            record.tuned = true;
+        }
+    }
+
+    // Save the choices once every kernel on every rank is tuned. This is
+    // collective over the communicator until tuning is finished and free
+    // afterwards.
+    void finish()
+    {
+        if ( _finished )
+            return;
+
+        int local_done = 1;
+        for ( const auto& record : _records )
+            if ( record.second.choice < 0 )
+                local_done = 0;
+        int global_done;
+        MPI_Allreduce( &local_done, &global_done, 1, MPI_INT, MPI_MIN, _comm );
+        if ( !global_done )
+            return;
+
+        _finished = true;
+        if ( !_cache_file.empty() )
+            saveCache();
+    }
+
+  private:
+    // Start a launch of the kernel with the given key.
+    template <class ExecutionSpace>
+    int startKey( const ExecutionSpace& exec_space, const std::string& kernel,
+                  const int num_candidate )
+    {
+        if ( !_enabled )
+            return 0;
+
+        auto& record =
+            _records[std::string( ExecutionSpace::name() ) + " " + kernel];
+
+        // Cached choices from a different candidate list are tuned again.
+        if ( record.choice >= num_candidate )
+            record.choice = -1;
+        if ( record.choice >= 0 )
+            return record.choice;
+
+        if ( record.times.empty() )
+            record.times.assign( num_candidate,
+                                 std::numeric_limits<double>::max() );
+        _active = &record;
+        _active_candidate = record.count % num_candidate;
+        exec_space.fence();
+        _timer.reset();
+        return _active_candidate;
+    }
+
+    struct Record
+    {
+        // Fastest time of each candidate.
+        std::vector<double> times;
+        // Number of timed launches.
+        int count = 0;
+        // Selected candidate or -1 while tuning.
+        int choice = -1;
+        // Selected in this run rather than read from the cache.
+        bool tuned = false;
+    };
+
+    // Cache entries are a host, a kernel key, and a choice separated by
+    // spaces. The choice is the last token.
+    void loadCache()
+    {
+        std::ifstream file( _cache_file );
+        std::string line;
+        std::string prefix = _host + " ";
+        while ( std::getline( file, line ) )
+        {
+            auto split = line.find_last_of( ' ' );
+            if ( std::string::npos == split || 0 != line.find( prefix ) )
+                continue;
+            std::string key =
+                line.substr( prefix.size(), split - prefix.size() );
+            _records[key].choice = std::stoi( line.substr( split + 1 ) );
+        }
+    }
+
+    // Gather the new choices of all ranks on rank 0 and merge them into the
+    // cache file.
+    void saveCache()
+    {
+        std::string local_entries;
+        for ( const auto& record : _records )
+            if ( record.second.tuned )
+                local_entries += _host + " " + record.first + " " +
+                                 std::to_string( record.second.choice ) +
+                                 "\n";
+
+        int rank, comm_size;
+        MPI_Comm_rank( _comm, &rank );
+        MPI_Comm_size( _comm, &comm_size );
+        int local_size = local_entries.size();
+        std::vector<int> sizes( comm_size );
+        MPI_Gather( &local_size, 1, MPI_INT, sizes.data(), 1, MPI_INT, 0,
+                    _comm );
+        std::vector<int> offsets( comm_size, 0 );
+        for ( int r = 1; r < comm_size; ++r )
+            offsets[r] = offsets[r - 1] + sizes[r - 1];
+        std::vector<char> entries(
+            ( 0 == rank ) ? offsets.back() + sizes.back() : 0 );
+        MPI_Gatherv( local_entries.data(), local_size, MPI_CHAR,
+                     entries.data(), sizes.data(), offsets.data(), MPI_CHAR,
+                     0, _comm );
+        if ( 0 != rank )
+            return;
+
+        // Later entries for the same host and kernel replace earlier ones.
+        std::map<std::string, std::string> cache;
+        std::vector<std::string> order;
+        auto add = [&]( const std::string& line ) {
+            auto split = line.find_last_of( ' ' );
+            if ( std::string::npos == split )
+                return;
+            auto id = line.substr( 0, split );
+            if ( !cache.count( id ) )
+                order.push_back( id );
+            cache[id] = line.substr( split + 1 );
+        };
+        {
+            std::ifstream file( _cache_file );
+            std::string line;
+            while ( std::getline( file, line ) )
+                add( line );
+        }
+        std::string new_entries( entries.begin(), entries.end() );
+        std::size_t begin = 0;
+        std::size_t end;
+        while ( std::string::npos != ( end = new_entries.find( '\n', begin ) ) )
+        {
+            add( new_entries.substr( begin, end - begin ) );
+            begin = end + 1;
+        }
+
+        std::ofstream file( _cache_file, std::ios::trunc );
+        for ( const auto& id : order )
+            file << id << " " << cache[id] << "\n";
+    }
+
+    bool _enabled;
+    int _trials;
+    std::string _cache_file;
+    MPI_Comm _comm;
+    bool _finished;
+    std::string _host;
+    std::map<std::string, Record> _records;
+    Record* _active;
+    int _active_candidate;
+    Kokkos::Timer _timer;
+};
+
+//---------------------------------------------------------------------------//
+// Create a 3D execution policy over an index space with a tile candidate.
+template <class ExecutionSpace>
+Kokkos::MDRangePolicy<ExecutionSpace, Kokkos::Rank<3>>
+createTunedPolicy( const Cajita::IndexSpace<3>& index_space,
+                   const ExecutionSpace& exec_space, const int candidate )
+{
+    using policy_type = Kokkos::MDRangePolicy<ExecutionSpace, Kokkos::Rank<3>>;
+    typename policy_type::point_type lower;
+    typename policy_type::point_type upper;
+    typename policy_type::tile_type tile;
+    auto tile_shape = Autotuner::tile( candidate );
+    for ( int d = 0; d < 3; ++d )
+    {
+        lower[d] = index_space.min( d );
+        upper[d] = index_space.max( d );
+        tile[d] = tile_shape[d];
+    }
+    return policy_type( exec_space, lower, upper, tile );
+}
+
+//---------------------------------------------------------------------------//
+// Set the chunk size of a range policy from a candidate.
+template <class Policy>
+Policy setTunedChunkSize( Policy policy, const int candidate )
+{
+    int chunk_size = Autotuner::chunkSize( candidate );
+    if ( chunk_size > 0 )
+        policy.set_chunk_size( chunk_size );
+    return policy;
+}
+
+//---------------------------------------------------------------------------//
+
+} // end namespace ExaMPM
+
+#endif // EXAMPM_AUTOTUNE_HPP
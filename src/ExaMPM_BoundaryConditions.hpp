@@ -12,8 +12,15 @@
 #ifndef EXAMPM_BOUNDARYCONDITIONS_HPP
 #define EXAMPM_BOUNDARYCONDITIONS_HPP
 
+#include <Cajita.hpp>
+
 #include <Kokkos_Core.hpp>
 
+#include <array>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
 namespace ExaMPM
 {
 //---------------------------------------------------------------------------//
@@ -30,104 +37,418 @@ struct BoundaryType
 //---------------------------------------------------------------------------//
 struct BoundaryCondition
 {
+    // Get the mask of velocity components constrained at a node. Bit d is set
+    // if component d is set to zero.
     KOKKOS_INLINE_FUNCTION
-    void operator()( const int gi, const int gj, const int gk, double& ux,
-                     double& uy, double& uz ) const
+    int mask( const int gi, const int gj, const int gk ) const
     {
-        // Low x
-        if ( gi <= min[0] )
+        int m = 0;
+        int g[3] = { gi, gj, gk };
+        for ( int d = 0; d < 3; ++d )
         {
-            if ( boundary[0] == BoundaryType::NO_SLIP )
-            {
-                ux = 0.0;
-                uy = 0.0;
-                uz = 0.0;
-            }
-            else if ( boundary[0] == BoundaryType::FREE_SLIP )
-            {
-                ux = 0.0;
-            }
-        }
+            // Low face
+            if ( g[d] <= min[d] )
+                m |= faceMask( boundary[d], d );
 
-        // Low y
-        if ( gj <= min[1] )
-        {
-            if ( boundary[1] == BoundaryType::NO_SLIP )
-            {
-                ux = 0.0;
-                uy = 0.0;
-                uz = 0.0;
-            }
-            else if ( boundary[1] == BoundaryType::FREE_SLIP )
-            {
-                uy = 0.0;
-            }
+            // High face
+            if ( g[d] >= max[d] - 1 )
+                m |= faceMask( boundary[d + 3], d );
         }
+        return m;
+    }
 
-        // Low z
-        if ( gk <= min[2] )
-        {
-            if ( boundary[2] == BoundaryType::NO_SLIP )
-            {
-                ux = 0.0;
-                uy = 0.0;
-                uz = 0.0;
-            }
-            else if ( boundary[2] == BoundaryType::FREE_SLIP )
-            {
-                uz = 0.0;
-            }
-        }
+    KOKKOS_INLINE_FUNCTION
+    void operator()( const int gi, const int gj, const int gk, double& ux,
+                     double& uy, double& uz ) const
+    {
+        int m = mask( gi, gj, gk );
+        if ( m & 1 )
+            ux = 0.0;
+        if ( m & 2 )
+            uy = 0.0;
+        if ( m & 4 )
+            uz = 0.0;
+    }
 
-        // High x
-        if ( gi >= max[0] - 1 )
-        {
-            if ( boundary[3] == BoundaryType::NO_SLIP )
-            {
-                ux = 0.0;
-                uy = 0.0;
-                uz = 0.0;
-            }
-            else if ( boundary[3] == BoundaryType::FREE_SLIP )
-            {
-                ux = 0.0;
-            }
-        }
+    // Mask of the components constrained by a face normal to dimension d.
+    KOKKOS_INLINE_FUNCTION
+    static constexpr int faceMask( const int type, const int d )
+    {
+        return ( type == BoundaryType::NO_SLIP )
+                   ? 7
+                   : ( ( type == BoundaryType::FREE_SLIP ) ? ( 1 << d ) : 0 );
+    }
 
-        // High y
-        if ( gj >= max[1] - 1 )
-        {
-            if ( boundary[4] == BoundaryType::NO_SLIP )
-            {
-                ux = 0.0;
-                uy = 0.0;
-                uz = 0.0;
-            }
-            else if ( boundary[4] == BoundaryType::FREE_SLIP )
-            {
-                uy = 0.0;
-            }
-        }
+    Kokkos::Array<int, 6> boundary;
+    Kokkos::Array<int, 3> min;
+    Kokkos::Array<int, 3> max;
+};
 
-        // High z
-        if ( gk >= max[2] - 1 )
-        {
-            if ( boundary[5] == BoundaryType::NO_SLIP )
-            {
-                ux = 0.0;
-                uy = 0.0;
-                uz = 0.0;
-            }
-            else if ( boundary[5] == BoundaryType::FREE_SLIP )
+//---------------------------------------------------------------------------//
+// Compile-time boundary types of a single face.
+struct NoBoundary
+{
+    static constexpr int type = BoundaryType::NONE;
+};
+
+struct NoSlip
+{
+    static constexpr int type = BoundaryType::NO_SLIP;
+};
+
+struct FreeSlip
+{
+    static constexpr int type = BoundaryType::FREE_SLIP;
+};
+
+// Periodic faces have no boundary condition.
+using Periodic = NoBoundary;
+
+//---------------------------------------------------------------------------//
+/*!
+  \class BoundaryPolicy
+  \brief Boundary condition with the type of each face fixed at compile time.
+
+  Faces are ordered as low x, low y, low z, high x, high y, high z to match
+  BoundaryCondition::boundary.
+*/
+template <class... Faces>
+struct BoundaryPolicy
+{
+    static_assert( 6 == sizeof...( Faces ), "One boundary type per face" );
+
+    // Boundary type of a face.
+    static constexpr int type( const int face )
+    {
+        constexpr int types[6] = { Faces::type... };
+        return types[face];
+    }
+
+    // Mask of the components constrained by a face.
+    static constexpr int faceMask( const int face )
+    {
+        return BoundaryCondition::faceMask( type( face ), face % 3 );
+    }
+
+    // Check if a runtime boundary condition has the types of this policy.
+    static bool matches( const BoundaryCondition& bc )
+    {
+        for ( int f = 0; f < 6; ++f )
+            if ( bc.boundary[f] != type( f ) )
+                return false;
+        return true;
+    }
+};
+
+// Common policies.
+using NoBoundaryPolicy = BoundaryPolicy<NoBoundary, NoBoundary, NoBoundary,
+                                        NoBoundary, NoBoundary, NoBoundary>;
+using FreeSlipPolicy =
+    BoundaryPolicy<FreeSlip, FreeSlip, FreeSlip, FreeSlip, FreeSlip, FreeSlip>;
+using NoSlipPolicy =
+    BoundaryPolicy<NoSlip, NoSlip, NoSlip, NoSlip, NoSlip, NoSlip>;
+
+// Boundary condition with the type of each face chosen at runtime.
+struct RuntimeBoundaryPolicy
+{
+    // Any runtime boundary condition is accepted.
+    static bool matches( const BoundaryCondition& ) { return true; }
+};
+
+//---------------------------------------------------------------------------//
+// Ghosted nodes affected by any face of a runtime boundary condition.
+struct BoundaryNodePredicate
+{
+    BoundaryCondition bc;
+
+    KOKKOS_INLINE_FUNCTION
+    bool operator()( const int g[3] ) const
+    {
+        return bc.mask( g[0], g[1], g[2] );
+    }
+};
+
+// Ghosted nodes on or beyond a single face of the domain.
+struct FaceNodePredicate
+{
+    int dim;
+    bool low;
+    int bound;
+
+    KOKKOS_INLINE_FUNCTION
+    bool operator()( const int g[3] ) const
+    {
+        return low ? ( g[dim] <= bound ) : ( g[dim] >= bound - 1 );
+    }
+};
+
+//---------------------------------------------------------------------------//
+// Local and global index of a ghosted node in the linear ordering of the
+// ghosted node index space.
+template <class L2G>
+struct GhostedNodeIndex
+{
+    L2G l2g;
+    Kokkos::Array<int, 3> min;
+    Kokkos::Array<int, 3> extent;
+
+    KOKKOS_INLINE_FUNCTION
+    void operator()( const int n, int idx[3], int g[3] ) const
+    {
+        idx[0] = min[0] + n % extent[0];
+        idx[1] = min[1] + ( n / extent[0] ) % extent[1];
+        idx[2] = min[2] + n / ( extent[0] * extent[1] );
+        l2g( idx[0], idx[1], idx[2], g[0], g[1], g[2] );
+    }
+};
+
+//---------------------------------------------------------------------------//
+// Build the list of local indices of the ghosted nodes whose global index
+// satisfies a predicate.
+template <class MemorySpace, class ExecutionSpace, class LocalGridType,
+          class Predicate>
+Kokkos::View<int* [3], MemorySpace>
+buildNodeList( const ExecutionSpace& exec_space,
+               const LocalGridType& local_grid, const Predicate& predicate )
+{
+    auto l2g = Cajita::IndexConversion::createL2G( local_grid, Cajita::Node() );
+    auto ghosted_nodes = local_grid.indexSpace( Cajita::Ghost(), Cajita::Node(),
+                                                Cajita::Local() );
+    int num_node = ghosted_nodes.size();
+    GhostedNodeIndex<decltype( l2g )> node_index{
+        l2g,
+        { static_cast<int>( ghosted_nodes.min( 0 ) ),
+          static_cast<int>( ghosted_nodes.min( 1 ) ),
+          static_cast<int>( ghosted_nodes.min( 2 ) ) },
+        { static_cast<int>( ghosted_nodes.extent( 0 ) ),
+          static_cast<int>( ghosted_nodes.extent( 1 ) ),
+          static_cast<int>( ghosted_nodes.extent( 2 ) ) } };
+
+    // Count the nodes.
+    int num_list = 0;
+    Kokkos::parallel_reduce(
+        "boundary_node_count",
+        Kokkos::RangePolicy<ExecutionSpace>( exec_space, 0, num_node ),
+        KOKKOS_LAMBDA( const int n, int& count ) {
+            int idx[3];
+            int g[3];
+            node_index( n, idx, g );
+            if ( predicate( g ) )
+                ++count;
+        },
+        num_list );
+
+    // Fill the list.
+    Kokkos::View<int* [3], MemorySpace> nodes(
+        Kokkos::ViewAllocateWithoutInitializing( "boundary_nodes" ),
+        num_list );
+    Kokkos::parallel_scan(
+        "boundary_node_fill",
+        Kokkos::RangePolicy<ExecutionSpace>( exec_space, 0, num_node ),
+        KOKKOS_LAMBDA( const int n, int& offset, const bool final_pass ) {
+            int idx[3];
+            int g[3];
+            node_index( n, idx, g );
+            if ( predicate( g ) )
             {
-                uz = 0.0;
+                if ( final_pass )
+                    for ( int d = 0; d < 3; ++d )
+                        nodes( offset, d ) = idx[d];
+                ++offset;
             }
-        }
+        } );
+
+    return nodes;
+}
+
+//---------------------------------------------------------------------------//
+/*!
+  \class BoundaryNodeList
+  \brief Compact list of the local nodes affected by a boundary condition.
+
+  The list holds the local index of every ghosted node with at least one
+  constrained velocity component along with the mask of constrained
+  components. It is built once and lets the boundary condition be applied in
+  a separate kernel over only the boundary nodes so the node loops of the
+  solver do not have to evaluate the boundary condition.
+
+  This is the runtime version used when the face types are not known at
+  compile time.
+*/
+template <class MemorySpace, class BoundaryPolicyType = RuntimeBoundaryPolicy>
+class BoundaryNodeList
+{
+  public:
+    using memory_space = MemorySpace;
+
+    BoundaryNodeList() = default;
+
+    template <class ExecutionSpace, class LocalGridType>
+    BoundaryNodeList( const ExecutionSpace& exec_space,
+                      const BoundaryCondition& bc,
+                      const LocalGridType& local_grid )
+    {
+        _nodes = buildNodeList<MemorySpace>( exec_space, local_grid,
+                                             BoundaryNodePredicate{ bc } );
+
+        // Compute the mask of each node.
+        _mask = Kokkos::View<int*, MemorySpace>(
+            Kokkos::ViewAllocateWithoutInitializing( "boundary_mask" ),
+            _nodes.extent( 0 ) );
+        auto nodes = _nodes;
+        auto mask = _mask;
+        auto l2g =
+            Cajita::IndexConversion::createL2G( local_grid, Cajita::Node() );
+        Kokkos::parallel_for(
+            "boundary_node_mask",
+            Kokkos::RangePolicy<ExecutionSpace>( exec_space, 0, size() ),
+            KOKKOS_LAMBDA( const int b ) {
+                int gi, gj, gk;
+                l2g( nodes( b, 0 ), nodes( b, 1 ), nodes( b, 2 ), gi, gj, gk );
+                mask( b ) = bc.mask( gi, gj, gk );
+            } );
     }
 
-    Kokkos::Array<int, 6> boundary;
-    Kokkos::Array<int, 3> min;
-    Kokkos::Array<int, 3> max;
+    // Number of boundary nodes.
+    int size() const { return _nodes.extent( 0 ); }
+
+    // Apply the boundary condition to a node vector field. A positive chunk
+    // size overrides the default of the range policy.
+    template <class ExecutionSpace, class ViewType>
+    void apply( const ExecutionSpace& exec_space, const std::string& label,
+                const ViewType& u, const int chunk_size = 0 ) const
+    {
+        auto nodes = _nodes;
+        auto mask = _mask;
+        Kokkos::RangePolicy<ExecutionSpace> policy( exec_space, 0, size() );
+        if ( chunk_size > 0 )
+            policy.set_chunk_size( chunk_size );
+        Kokkos::parallel_for(
+            label, policy,
+            KOKKOS_LAMBDA( const int b ) {
+                int i = nodes( b, 0 );
+                int j = nodes( b, 1 );
+                int k = nodes( b, 2 );
+                for ( int d = 0; d < 3; ++d )
+                    if ( mask( b ) & ( 1 << d ) )
+                        u( i, j, k, d ) = 0.0;
+            } );
+    }
+
+  private:
+    Kokkos::View<int* [3], MemorySpace> _nodes;
+    Kokkos::View<int*, MemorySpace> _mask;
+};
+
+//---------------------------------------------------------------------------//
+/*!
+  \brief Boundary node lists for a compile-time boundary policy.
+
+  One list of nodes is kept per face. Each face is applied with its own
+  kernel in which the constrained components are compile-time constants so
+  the kernels are branch-free. Faces without a boundary condition have no
+  list and no kernel, so a fully periodic problem compiles the boundary pass
+  away entirely.
+*/
+template <class MemorySpace, class... Faces>
+class BoundaryNodeList<MemorySpace, BoundaryPolicy<Faces...>>
+{
+  public:
+    using memory_space = MemorySpace;
+
+    using policy_type = BoundaryPolicy<Faces...>;
+
+    BoundaryNodeList() = default;
+
+    template <class ExecutionSpace, class LocalGridType>
+    BoundaryNodeList( const ExecutionSpace& exec_space,
+                      const BoundaryCondition& bc,
+                      const LocalGridType& local_grid )
+    {
+        if ( !policy_type::matches( bc ) )
+            throw std::logic_error(
+                "Boundary condition does not match the boundary policy" );
+
+        for ( int f = 0; f < 6; ++f )
+            if ( policy_type::faceMask( f ) )
+                _faces[f] = buildNodeList<MemorySpace>(
+                    exec_space, local_grid,
+                    FaceNodePredicate{ f % 3, f < 3,
+                                       ( f < 3 ) ? bc.min[f % 3]
+                                                 : bc.max[f % 3] } );
+    }
+
+    // Number of boundary nodes over all faces. Nodes on edges and corners
+    // are counted once per face.
+    int size() const
+    {
+        int num_node = 0;
+        for ( int f = 0; f < 6; ++f )
+            num_node += _faces[f].extent( 0 );
+        return num_node;
+    }
+
+    // Apply the boundary condition to a node vector field. A positive chunk
+    // size overrides the default of the range policies.
+    template <class ExecutionSpace, class ViewType>
+    void apply( const ExecutionSpace& exec_space, const std::string& label,
+                const ViewType& u, const int chunk_size = 0 ) const
+    {
+        applyFace<0>( exec_space, label, u, chunk_size );
+        applyFace<1>( exec_space, label, u, chunk_size );
+        applyFace<2>( exec_space, label, u, chunk_size );
+        applyFace<3>( exec_space, label, u, chunk_size );
+        applyFace<4>( exec_space, label, u, chunk_size );
+        applyFace<5>( exec_space, label, u, chunk_size );
+    }
+
+  private:
+    template <int Face, class ExecutionSpace, class ViewType>
+    void applyFace( const ExecutionSpace& exec_space, const std::string& label,
+                    const ViewType& u, const int chunk_size ) const
+    {
+        applyFace<Face>(
+            exec_space, label, u, chunk_size,
+            std::integral_constant<bool,
+                                   ( 0 != policy_type::faceMask( Face ) )>() );
+    }
+
+    // Faces without a boundary condition do nothing.
+    template <int Face, class ExecutionSpace, class ViewType>
+    void applyFace( const ExecutionSpace&, const std::string&, const ViewType&,
+                    const int, std::false_type ) const
+    {
+    }
+
+    // Zero the constrained components on a face.
+    template <int Face, class ExecutionSpace, class ViewType>
+    void applyFace( const ExecutionSpace& exec_space, const std::string& label,
+                    const ViewType& u, const int chunk_size,
+                    std::true_type ) const
+    {
+        constexpr int mask = policy_type::faceMask( Face );
+        auto nodes = _faces[Face];
+        Kokkos::RangePolicy<ExecutionSpace> policy( exec_space, 0,
+                                                    nodes.extent( 0 ) );
+        if ( chunk_size > 0 )
+            policy.set_chunk_size( chunk_size );
+        Kokkos::parallel_for(
+            label, policy,
+            KOKKOS_LAMBDA( const int b ) {
+                int i = nodes( b, 0 );
+                int j = nodes( b, 1 );
+                int k = nodes( b, 2 );
+                if ( mask & 1 )
+                    u( i, j, k, 0 ) = 0.0;
+                if ( mask & 2 )
+                    u( i, j, k, 1 ) = 0.0;
+                if ( mask & 4 )
+                    u( i, j, k, 2 ) = 0.0;
+            } );
+    }
+
+  private:
+    std::array<Kokkos::View<int* [3], MemorySpace>, 6> _faces;
 };
 
 //---------------------------------------------------------------------------//
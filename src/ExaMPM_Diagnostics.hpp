@@ -0,0 +1,267 @@
+/****************************************************************************
+ * Copyright (c) 2018-2020 by the ExaMPM authors                            *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the ExaMPM library. ExaMPM is distributed under a   *
+ * BSD 3-clause license. For the licensing terms see the LICENSE file in    *
+ * the top-level directory.                                                 *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#ifndef EXAMPM_DIAGNOSTICS_HPP
+#define EXAMPM_DIAGNOSTICS_HPP
+
+#include <ExaMPM_ProblemManager.hpp>
+
+#include <Kokkos_Core.hpp>
+
+#include <mpi.h>
+
+#include <cmath>
+#include <fstream>
+#include <ios>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+
+namespace ExaMPM
+{
+namespace Diagnostics
+{
+//---------------------------------------------------------------------------//
+// Global run summary. All values are packed in a single array of doubles so
+// the local result can be reduced over ranks with a single MPI_Reduce.
+struct Summary
+{
+    enum Values
+    {
+        // Summed quantities.
+        MASS = 0,
+        MOMENTUM_X = 1,
+        MOMENTUM_Y = 2,
+        MOMENTUM_Z = 3,
+        KINETIC_ENERGY = 4,
+        POTENTIAL_ENERGY = 5,
+        J_SUM = 6,
+        NUM_PARTICLE = 7,
+
+        // Minimum quantities.
+        J_MIN = 8,
+        MIN_RANK_PARTICLE = 9,
+
+        // Maximum quantities.
+        J_MAX = 10,
+        MAX_SPEED = 11,
+        MAX_RANK_PARTICLE = 12,
+
+        NUM_VALUE = 13
+    };
+
+    double values[NUM_VALUE];
+
+    KOKKOS_INLINE_FUNCTION
+    double& operator[]( const int n ) { return values[n]; }
+
+    KOKKOS_INLINE_FUNCTION
+    const double& operator[]( const int n ) const { return values[n]; }
+};
+
+//---------------------------------------------------------------------------//
+// Combine two summaries.
+template <class SummaryType, class OtherSummaryType>
+KOKKOS_INLINE_FUNCTION void combine( SummaryType& dst,
+                                     const OtherSummaryType& src )
+{
+    for ( int n = Summary::MASS; n < Summary::J_MIN; ++n )
+        dst.values[n] += src.values[n];
+    for ( int n = Summary::J_MIN; n < Summary::J_MAX; ++n )
+        if ( src.values[n] < dst.values[n] )
+            dst.values[n] = src.values[n];
+    for ( int n = Summary::J_MAX; n < Summary::NUM_VALUE; ++n )
+        if ( src.values[n] > dst.values[n] )
+            dst.values[n] = src.values[n];
+}
+
+//---------------------------------------------------------------------------//
+// Fused particle reduction. Every diagnostic quantity is accumulated in a
+// single pass over the particles.
+template <class MassSlice, class VelocitySlice, class PositionSlice,
+          class JSlice>
+struct ParticleReduction
+{
+    using value_type = Summary;
+
+    MassSlice m_p;
+    VelocitySlice u_p;
+    PositionSlice x_p;
+    JSlice j_p;
+    double gravity;
+
+    KOKKOS_INLINE_FUNCTION
+    void init( value_type& s ) const
+    {
+        for ( int n = Summary::MASS; n < Summary::J_MIN; ++n )
+            s.values[n] = 0.0;
+        for ( int n = Summary::J_MIN; n < Summary::J_MAX; ++n )
+            s.values[n] = Kokkos::reduction_identity<double>::min();
+        for ( int n = Summary::J_MAX; n < Summary::NUM_VALUE; ++n )
+            s.values[n] = Kokkos::reduction_identity<double>::max();
+    }
+
+    KOKKOS_INLINE_FUNCTION
+    void join( volatile value_type& dst, const volatile value_type& src ) const
+    {
+        combine( dst, src );
+    }
+
+    KOKKOS_INLINE_FUNCTION
+    void join( value_type& dst, const value_type& src ) const
+    {
+        combine( dst, src );
+    }
+
+    KOKKOS_INLINE_FUNCTION
+    void operator()( const ParticleIndex p, value_type& s ) const
+    {
+        double m = m_p( p );
+        double u2 = 0.0;
+        for ( int d = 0; d < 3; ++d )
+        {
+            s.values[Summary::MOMENTUM_X + d] += m * u_p( p, d );
+            u2 += u_p( p, d ) * u_p( p, d );
+        }
+
+        s.values[Summary::MASS] += m;
+        s.values[Summary::KINETIC_ENERGY] += 0.5 * m * u2;
+
+        // Gravity pulls down in z.
+        s.values[Summary::POTENTIAL_ENERGY] += m * gravity * x_p( p, 2 );
+
+        s.values[Summary::J_SUM] += j_p( p );
+        s.values[Summary::NUM_PARTICLE] += 1.0;
+
+        if ( j_p( p ) < s.values[Summary::J_MIN] )
+            s.values[Summary::J_MIN] = j_p( p );
+        if ( j_p( p ) > s.values[Summary::J_MAX] )
+            s.values[Summary::J_MAX] = j_p( p );
+        if ( u2 > s.values[Summary::MAX_SPEED] )
+            s.values[Summary::MAX_SPEED] = u2;
+    }
+};
+
+//---------------------------------------------------------------------------//
+// MPI reduction operator for packed summaries.
+inline void reduceSummary( void* in, void* inout, int* len,
+                           MPI_Datatype* datatype )
+{
+    std::ignore = datatype;
+    auto src = static_cast<Summary*>( in );
+    auto dst = static_cast<Summary*>( inout );
+    for ( int n = 0; n < *len; ++n )
+        combine( dst[n], src[n] );
+}
+
+//---------------------------------------------------------------------------//
+// Compute the global summary of the particle state. The result is only valid
+// on rank 0 of the communicator.
+template <class ExecutionSpace, class ProblemManagerType>
+Summary compute( const ExecutionSpace& exec_space,
+                 const ProblemManagerType& pm, const double gravity,
+                 MPI_Comm comm )
+{
+    Kokkos::Profiling::pushRegion( "Diagnostics::compute" );
+
+    auto m_p = pm.get( Location::Particle(), Field::Mass() );
+    auto u_p = pm.get( Location::Particle(), Field::Velocity() );
+    auto x_p = pm.get( Location::Particle(), Field::Position() );
+    auto j_p = pm.get( Location::Particle(), Field::J() );
+
+    ParticleReduction<decltype( m_p ), decltype( u_p ), decltype( x_p ),
+                      decltype( j_p )>
+        reduction{ m_p, u_p, x_p, j_p, gravity };
+
+    // Local reduction.
+    Summary local;
+    Kokkos::parallel_reduce(
+        "diagnostics",
+        ParticleRangePolicy<ExecutionSpace>( exec_space, 0, pm.numParticle() ),
+        reduction, local );
+    local[Summary::MIN_RANK_PARTICLE] = local[Summary::NUM_PARTICLE];
+    local[Summary::MAX_RANK_PARTICLE] = local[Summary::NUM_PARTICLE];
+
+    // Global reduction. The summary is sent as a single contiguous element
+    // so the operator always sees complete summaries.
+    MPI_Datatype summary_type;
+    MPI_Type_contiguous( Summary::NUM_VALUE, MPI_DOUBLE, &summary_type );
+    MPI_Type_commit( &summary_type );
+    MPI_Op summary_op;
+    MPI_Op_create( reduceSummary, 1, &summary_op );
+
+    Summary global;
+    MPI_Reduce( &local, &global, 1, summary_type, summary_op, 0, comm );
+
+    MPI_Op_free( &summary_op );
+    MPI_Type_free( &summary_type );
+
+    global[Summary::MAX_SPEED] = std::sqrt( global[Summary::MAX_SPEED] );
+
+    Kokkos::Profiling::popRegion();
+
+    return global;
+}
+
+//---------------------------------------------------------------------------//
+// Start a new diagnostics file and write the column header on rank 0.
+inline void writeHeader( MPI_Comm comm, const std::string& file_name )
+{
+    int comm_rank;
+    MPI_Comm_rank( comm, &comm_rank );
+    if ( 0 != comm_rank )
+        return;
+
+    std::ofstream file( file_name, std::ios::trunc );
+    if ( !file )
+        throw std::runtime_error( "Unable to open diagnostics file " +
+                                  file_name );
+    file << "step,time,mass,momentum_x,momentum_y,momentum_z,"
+         << "kinetic_energy,potential_energy,j_min,j_max,j_mean,"
+         << "max_speed,num_particle,min_rank_particle,max_rank_particle\n";
+}
+
+//---------------------------------------------------------------------------//
+// Append a global summary to the diagnostics file on rank 0.
+inline void write( MPI_Comm comm, const std::string& file_name,
+                   const int step, const double time, const Summary& s )
+{
+    int comm_rank;
+    MPI_Comm_rank( comm, &comm_rank );
+    if ( 0 != comm_rank )
+        return;
+
+    std::ofstream file( file_name, std::ios::app );
+    if ( !file )
+        throw std::runtime_error( "Unable to open diagnostics file " +
+                                  file_name );
+
+    double j_mean = ( s[Summary::NUM_PARTICLE] > 0.0 )
+                        ? s[Summary::J_SUM] / s[Summary::NUM_PARTICLE]
+                        : 0.0;
+
+    file.precision( 12 );
+    file << step << "," << time << "," << s[Summary::MASS] << ","
+         << s[Summary::MOMENTUM_X] << "," << s[Summary::MOMENTUM_Y] << ","
+         << s[Summary::MOMENTUM_Z] << "," << s[Summary::KINETIC_ENERGY] << ","
+         << s[Summary::POTENTIAL_ENERGY] << "," << s[Summary::J_MIN] << ","
+         << s[Summary::J_MAX] << "," << j_mean << "," << s[Summary::MAX_SPEED]
+         << "," << static_cast<long>( s[Summary::NUM_PARTICLE] ) << ","
+         << static_cast<long>( s[Summary::MIN_RANK_PARTICLE] ) << ","
+         << static_cast<long>( s[Summary::MAX_RANK_PARTICLE] ) << "\n";
+}
+
+//---------------------------------------------------------------------------//
+
+} // end namespace Diagnostics
+} // end namespace ExaMPM
+
+#endif // EXAMPM_DIAGNOSTICS_HPP
@@ -0,0 +1,93 @@
+/****************************************************************************
+ * Copyright (c) 2018-2020 by the ExaMPM authors                            *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the ExaMPM library. ExaMPM is distributed under a   *
+ * BSD 3-clause license. For the licensing terms see the LICENSE file in    *
+ * the top-level directory.                                                 *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#ifndef EXAMPM_FIRSTTOUCH_HPP
+#define EXAMPM_FIRSTTOUCH_HPP
+
+#include <ExaMPM_Types.hpp>
+
+#include <Cabana_Core.hpp>
+
+#include <Cajita.hpp>
+
+#include <Kokkos_Core.hpp>
+
+#include <memory>
+#include <string>
+
+namespace ExaMPM
+{
+//---------------------------------------------------------------------------//
+// NUMA-aware first touch. On host backends a memory page is placed on the
+// socket of the thread that first writes it. The helpers here allocate
+// without initialization and then write the data with the same policies the
+// compute kernels use so each thread's pages are local to it.
+//---------------------------------------------------------------------------//
+// Create a grid array. With first touch the array is zeroed with the
+// execution policy of the grid kernels over the ghosted entities instead of
+// the flat fill used by the default allocation.
+template <class Scalar, class MemorySpace, class ExecutionSpace,
+          class EntityType, class MeshType>
+std::shared_ptr<Cajita::Array<Scalar, EntityType, MeshType, MemorySpace>>
+createGridArray(
+    const ExecutionSpace& exec_space, const std::string& label,
+    const std::shared_ptr<Cajita::ArrayLayout<EntityType, MeshType>>& layout,
+    const bool first_touch )
+{
+    using array_type = Cajita::Array<Scalar, EntityType, MeshType, MemorySpace>;
+
+    if ( !first_touch )
+        return Cajita::createArray<Scalar, MemorySpace>( label, layout );
+
+    auto array_space = layout->indexSpace( Cajita::Ghost(), Cajita::Local() );
+    typename array_type::view_type view(
+        Kokkos::ViewAllocateWithoutInitializing( label ),
+        array_space.extent( 0 ), array_space.extent( 1 ),
+        array_space.extent( 2 ), array_space.extent( 3 ) );
+
+    int num_dof = array_space.extent( 3 );
+    auto entity_space = layout->localGrid()->indexSpace(
+        Cajita::Ghost(), EntityType(), Cajita::Local() );
+    Kokkos::parallel_for(
+        "grid_first_touch",
+        Cajita::createExecutionPolicy( entity_space, exec_space ),
+        KOKKOS_LAMBDA( const int i, const int j, const int k ) {
+            for ( int n = 0; n < num_dof; ++n )
+                view( i, j, k, n ) = 0;
+        } );
+    exec_space.fence();
+
+    return std::make_shared<array_type>( layout, view );
+}
+
+//---------------------------------------------------------------------------//
+// Move particles into a new allocation written by the particle loop policy
+// so each thread's particles are local to it.
+template <class ExecutionSpace, class ParticleList>
+void firstTouchParticles( const ExecutionSpace& exec_space,
+                          ParticleList& particles )
+{
+    ParticleList touched( particles.label(), particles.size() );
+    Kokkos::parallel_for(
+        "particle_first_touch",
+        ParticleRangePolicy<ExecutionSpace>( exec_space, 0, particles.size() ),
+        KOKKOS_LAMBDA( const ParticleIndex p ) {
+            touched.setTuple( p, particles.getTuple( p ) );
+        } );
+    exec_space.fence();
+    particles = touched;
+}
+
+//---------------------------------------------------------------------------//
+
+} // end namespace ExaMPM
+
+#endif // EXAMPM_FIRSTTOUCH_HPP
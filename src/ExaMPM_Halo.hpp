@@ -0,0 +1,362 @@
+/****************************************************************************
+ * Copyright (c) 2018-2020 by the ExaMPM authors                            *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the ExaMPM library. ExaMPM is distributed under a   *
+ * BSD 3-clause license. For the licensing terms see the LICENSE file in    *
+ * the top-level directory.                                                 *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#ifndef EXAMPM_HALO_HPP
+#define EXAMPM_HALO_HPP
+
+#include <Cajita.hpp>
+
+#include <Kokkos_Core.hpp>
+
+#include <mpi.h>
+
+#include <algorithm>
+#include <array>
+#include <initializer_list>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace ExaMPM
+{
+//---------------------------------------------------------------------------//
+/*!
+  \class GridHalo
+  \brief Sum-scatter and fused scatter-gather of several ghosted grid arrays.
+
+  Unlike the Cajita halo the arrays of one exchange may have different value
+  types and are all sent in one message per neighbor.
+
+  A scatter sums the ghost values into the owned entities. A scatter followed
+  by a gather needs two rounds of neighbor messages. The fused scatter-gather
+  instead sends the partial values of all entities shared with a neighbor
+  (owned or ghost) and sums the partials received, so every rank holding an
+  entity ends up with the full sum after a single round of messages. Ghost
+  entities beyond a non-periodic boundary have no owner and keep their local
+  partial values, as they do after a Cajita scatter and gather.
+
+  The fused exchange is only valid if every rank holding a copy of an entity
+  is a direct neighbor of every other rank holding it. The ghosted node
+  range of a block of N cells with halo width h is [-h,N+h] so this requires
+  the owned block to be larger than twice the halo width in every dimension.
+  Otherwise a node at the edge of the ghosted range is also held by the rank
+  two blocks away. Use canFuse() to check before calling scatterGather().
+*/
+template <class MemorySpace>
+class GridHalo
+{
+  public:
+    using memory_space = MemorySpace;
+
+    // Check if a local grid supports a fused exchange.
+    template <class LocalGridType>
+    static bool canFuse( const LocalGridType& local_grid )
+    {
+        auto owned_cells = local_grid.indexSpace( Cajita::Own(), Cajita::Cell(),
+                                                  Cajita::Local() );
+        int local_ok = 1;
+        for ( int d = 0; d < 3; ++d )
+            if ( owned_cells.extent( d ) <= 2 * local_grid.haloCellWidth() )
+                local_ok = 0;
+        int global_ok;
+        MPI_Allreduce( &local_ok, &global_ok, 1, MPI_INT, MPI_MIN,
+                       local_grid.globalGrid().comm() );
+        return global_ok;
+    }
+
+    template <class LocalGridType, class EntityType>
+    GridHalo( const LocalGridType& local_grid, EntityType )
+        : _comm( local_grid.globalGrid().comm() )
+        , _can_fuse( canFuse( local_grid ) )
+    {
+        auto ghosted = local_grid.indexSpace( Cajita::Ghost(), EntityType(),
+                                              Cajita::Local() );
+        auto owned = local_grid.indexSpace( Cajita::Own(), EntityType(),
+                                            Cajita::Local() );
+
+        // Range of a dimension held by this rank and its neighbors in that
+        // dimension. Ghost entities beyond a non-periodic boundary are not
+        // held by any other rank so they are left out.
+        std::array<long, 3> held_min;
+        std::array<long, 3> held_max;
+        for ( int d = 0; d < 3; ++d )
+        {
+            int low_off[3] = { 0, 0, 0 };
+            int high_off[3] = { 0, 0, 0 };
+            low_off[d] = -1;
+            high_off[d] = 1;
+            held_min[d] = ( local_grid.neighborRank( low_off[0], low_off[1],
+                                                     low_off[2] ) < 0 )
+                              ? owned.min( d )
+                              : ghosted.min( d );
+            held_max[d] = ( local_grid.neighborRank( high_off[0], high_off[1],
+                                                     high_off[2] ) < 0 )
+                              ? owned.max( d )
+                              : ghosted.max( d );
+        }
+
+        for ( int k = -1; k < 2; ++k )
+            for ( int j = -1; j < 2; ++j )
+                for ( int i = -1; i < 2; ++i )
+                {
+                    if ( 0 == i && 0 == j && 0 == k )
+                        continue;
+                    int rank = local_grid.neighborRank( i, j, k );
+                    if ( rank < 0 )
+                        continue;
+
+                    // A scatter sends the ghosts owned by the neighbor and
+                    // receives into the owned entities it ghosts.
+                    auto shared_own = local_grid.sharedIndexSpace(
+                        Cajita::Own(), EntityType(), i, j, k );
+                    auto shared_ghost = local_grid.sharedIndexSpace(
+                        Cajita::Ghost(), EntityType(), i, j, k );
+
+                    // A fused exchange uses all entities held by both this
+                    // rank and the neighbor. In dimensions where the neighbor
+                    // is offset this is the union of the owned entities it
+                    // ghosts and the ghost entities it owns. Otherwise it is
+                    // the held range of the dimension.
+                    int off[3] = { i, j, k };
+                    std::array<long, 3> min;
+                    std::array<long, 3> max;
+                    for ( int d = 0; d < 3; ++d )
+                    {
+                        if ( 0 == off[d] )
+                        {
+                            min[d] = held_min[d];
+                            max[d] = held_max[d];
+                        }
+                        else
+                        {
+                            min[d] = std::min( shared_own.min( d ),
+                                               shared_ghost.min( d ) );
+                            max[d] = std::max( shared_own.max( d ),
+                                               shared_ghost.max( d ) );
+                        }
+                    }
+
+                    _neighbor_ranks.push_back( rank );
+                    _neighbor_ids.push_back( ( i + 1 ) + 3 * ( j + 1 ) +
+                                             9 * ( k + 1 ) );
+                    _owned_spaces.push_back( shared_own );
+                    _ghost_spaces.push_back( shared_ghost );
+                    _shared_spaces.push_back(
+                        Cajita::IndexSpace<3>( min, max ) );
+                }
+
+        _send_buffers.resize( _neighbor_ranks.size() );
+        _recv_buffers.resize( _neighbor_ranks.size() );
+    }
+
+    // Whether scatterGather() may be used.
+    bool fusable() const { return _can_fuse; }
+
+    // Sum the ghost values of the arrays into their owned entities. All
+    // arrays must be defined on the entity type of the halo.
+    template <class ExecutionSpace, class... ArrayTypes>
+    void scatter( const ExecutionSpace& exec_space,
+                  const ArrayTypes&... arrays )
+    {
+        exchange( exec_space, _ghost_spaces, _owned_spaces, arrays... );
+    }
+
+    // Sum the partial values of the arrays over all ranks holding each
+    // entity. All arrays must be defined on the entity type of the halo.
+    template <class ExecutionSpace, class... ArrayTypes>
+    void scatterGather( const ExecutionSpace& exec_space,
+                        const ArrayTypes&... arrays )
+    {
+        if ( !_can_fuse )
+            throw std::logic_error(
+                "Owned blocks too small for a fused scatter-gather" );
+        exchange( exec_space, _shared_spaces, _shared_spaces, arrays... );
+    }
+
+  private:
+    // Send the values of the send spaces to each neighbor and sum the
+    // received values into the receive spaces. The receive space of a
+    // neighbor must match the send space of that neighbor towards this rank.
+    template <class ExecutionSpace, class... ArrayTypes>
+    void exchange( const ExecutionSpace& exec_space,
+                   const std::vector<Cajita::IndexSpace<3>>& send_spaces,
+                   const std::vector<Cajita::IndexSpace<3>>& recv_spaces,
+                   const ArrayTypes&... arrays )
+    {
+        int num_n = _neighbor_ranks.size();
+
+        // Pack the values of every array before any are modified.
+        for ( int n = 0; n < num_n; ++n )
+        {
+            std::size_t send_bytes = 0;
+            std::initializer_list<int>{
+                ( send_bytes += packedBytes( send_spaces[n], arrays.view() ),
+                  0 )... };
+            if ( _send_buffers[n].extent( 0 ) < send_bytes )
+                _send_buffers[n] = Kokkos::View<char*, MemorySpace>(
+                    Kokkos::ViewAllocateWithoutInitializing( "halo_send" ),
+                    send_bytes );
+
+            std::size_t recv_bytes = 0;
+            std::initializer_list<int>{
+                ( recv_bytes += packedBytes( recv_spaces[n], arrays.view() ),
+                  0 )... };
+            if ( _recv_buffers[n].extent( 0 ) < recv_bytes )
+                _recv_buffers[n] = Kokkos::View<char*, MemorySpace>(
+                    Kokkos::ViewAllocateWithoutInitializing( "halo_recv" ),
+                    recv_bytes );
+
+            std::size_t offset = 0;
+            std::initializer_list<int>{
+                ( copyRegion( exec_space, send_spaces[n], _send_buffers[n],
+                              offset, arrays.view(), std::false_type() ),
+                  0 )... };
+        }
+        exec_space.fence();
+
+        // Exchange. The tag identifies the neighbor direction so multiple
+        // exchanges with the same rank (e.g. periodic self neighbors) do not
+        // mix. Messages sent towards direction id are received from direction
+        // 26 - id.
+        const int mpi_tag = 3012;
+        std::vector<MPI_Request> requests( 2 * num_n, MPI_REQUEST_NULL );
+        for ( int n = 0; n < num_n; ++n )
+        {
+            int count = 0;
+            std::initializer_list<int>{
+                ( count += packedBytes( recv_spaces[n], arrays.view() ),
+                  0 )... };
+            MPI_Irecv( _recv_buffers[n].data(), count, MPI_BYTE,
+                       _neighbor_ranks[n], mpi_tag + 26 - _neighbor_ids[n],
+                       _comm, &requests[n] );
+        }
+        for ( int n = 0; n < num_n; ++n )
+        {
+            int count = 0;
+            std::initializer_list<int>{
+                ( count += packedBytes( send_spaces[n], arrays.view() ),
+                  0 )... };
+            MPI_Isend( _send_buffers[n].data(), count, MPI_BYTE,
+                       _neighbor_ranks[n], mpi_tag + _neighbor_ids[n], _comm,
+                       &requests[num_n + n] );
+        }
+
+        // Sum the received values as they arrive.
+        for ( int c = 0; c < num_n; ++c )
+        {
+            int n = MPI_UNDEFINED;
+            MPI_Waitany( num_n, requests.data(), &n, MPI_STATUS_IGNORE );
+            if ( MPI_UNDEFINED == n )
+                break;
+            std::size_t offset = 0;
+            std::initializer_list<int>{
+                ( copyRegion( exec_space, recv_spaces[n], _recv_buffers[n],
+                              offset, arrays.view(), std::true_type() ),
+                  0 )... };
+        }
+
+        MPI_Waitall( num_n, requests.data() + num_n, MPI_STATUSES_IGNORE );
+        exec_space.fence();
+    }
+
+    // Bytes used by a view in a buffer. Each view starts on an 8-byte
+    // boundary.
+    template <class ViewType>
+    static std::size_t packedBytes( const Cajita::IndexSpace<3>& space,
+                                    const ViewType& view )
+    {
+        std::size_t bytes = space.size() * view.extent( 3 ) *
+                            sizeof( typename ViewType::value_type );
+        return 8 * ( ( bytes + 7 ) / 8 );
+    }
+
+    // Pack a region of a view into a buffer.
+    template <class ExecutionSpace, class ViewType>
+    static void copyRegion( const ExecutionSpace& exec_space,
+                            const Cajita::IndexSpace<3>& space,
+                            const Kokkos::View<char*, MemorySpace>& buffer,
+                            std::size_t& offset, const ViewType& view,
+                            std::false_type )
+    {
+        auto packed = packedView( space, buffer, offset, view );
+        int min[3] = { static_cast<int>( space.min( 0 ) ),
+                       static_cast<int>( space.min( 1 ) ),
+                       static_cast<int>( space.min( 2 ) ) };
+        int num_comp = view.extent( 3 );
+        Kokkos::parallel_for(
+            "halo_pack",
+            Cajita::createExecutionPolicy( space, exec_space ),
+            KOKKOS_LAMBDA( const int i, const int j, const int k ) {
+                for ( int c = 0; c < num_comp; ++c )
+                    packed( i - min[0], j - min[1], k - min[2], c ) =
+                        view( i, j, k, c );
+            } );
+        offset += packedBytes( space, view );
+    }
+
+    // Sum a packed buffer into a region of a view.
+    template <class ExecutionSpace, class ViewType>
+    static void copyRegion( const ExecutionSpace& exec_space,
+                            const Cajita::IndexSpace<3>& space,
+                            const Kokkos::View<char*, MemorySpace>& buffer,
+                            std::size_t& offset, const ViewType& view,
+                            std::true_type )
+    {
+        auto packed = packedView( space, buffer, offset, view );
+        int min[3] = { static_cast<int>( space.min( 0 ) ),
+                       static_cast<int>( space.min( 1 ) ),
+                       static_cast<int>( space.min( 2 ) ) };
+        int num_comp = view.extent( 3 );
+        Kokkos::parallel_for(
+            "halo_unpack",
+            Cajita::createExecutionPolicy( space, exec_space ),
+            KOKKOS_LAMBDA( const int i, const int j, const int k ) {
+                for ( int c = 0; c < num_comp; ++c )
+                    view( i, j, k, c ) +=
+                        packed( i - min[0], j - min[1], k - min[2], c );
+            } );
+        offset += packedBytes( space, view );
+    }
+
+    // Get an unmanaged view of a region of a buffer.
+    template <class ViewType>
+    static Kokkos::View<typename ViewType::non_const_value_type****,
+                        Kokkos::LayoutRight, MemorySpace,
+                        Kokkos::MemoryUnmanaged>
+    packedView( const Cajita::IndexSpace<3>& space,
+                const Kokkos::View<char*, MemorySpace>& buffer,
+                const std::size_t offset, const ViewType& view )
+    {
+        using value_type = typename ViewType::non_const_value_type;
+        return Kokkos::View<value_type****, Kokkos::LayoutRight, MemorySpace,
+                            Kokkos::MemoryUnmanaged>(
+            reinterpret_cast<value_type*>( buffer.data() + offset ),
+            space.extent( 0 ), space.extent( 1 ), space.extent( 2 ),
+            view.extent( 3 ) );
+    }
+
+  private:
+    MPI_Comm _comm;
+    bool _can_fuse;
+    std::vector<int> _neighbor_ranks;
+    std::vector<int> _neighbor_ids;
+    std::vector<Cajita::IndexSpace<3>> _owned_spaces;
+    std::vector<Cajita::IndexSpace<3>> _ghost_spaces;
+    std::vector<Cajita::IndexSpace<3>> _shared_spaces;
+    std::vector<Kokkos::View<char*, MemorySpace>> _send_buffers;
+    std::vector<Kokkos::View<char*, MemorySpace>> _recv_buffers;
+};
+
+//---------------------------------------------------------------------------//
+
+} // end namespace ExaMPM
+
+#endif // EXAMPM_HALO_HPP
@@ -0,0 +1,280 @@
+/****************************************************************************
+ * Copyright (c) 2018-2020 by the ExaMPM authors                            *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the ExaMPM library. ExaMPM is distributed under a   *
+ * BSD 3-clause license. For the licensing terms see the LICENSE file in    *
+ * the top-level directory.                                                 *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#ifndef EXAMPM_PACKEDPOSITION_HPP
+#define EXAMPM_PACKEDPOSITION_HPP
+
+#include <ExaMPM_Types.hpp>
+
+#include <Cajita.hpp>
+
+#include <Kokkos_Core.hpp>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+namespace ExaMPM
+{
+//---------------------------------------------------------------------------//
+/*!
+  \class PackedPositionCodec
+  \brief Fixed-point encoding of particle positions relative to their cell.
+
+  A position is stored as a 32-bit cell index and a 64-bit word holding a
+  21-bit fixed-point offset within the cell in each dimension, 12 bytes
+  instead of 24. The cell index packs the cell in each dimension into a bit
+  field so decoding only needs shifts and masks. Cells are counted from the
+  low corner of the ghosted block of the rank padded by one cell, so the
+  size limit applies to the local block and not the global grid. Positions
+  outside of the padded block abort. The codec depends on the local grid so
+  particles are decoded before they migrate and encoded with the codec of
+  the receiving rank. The resolution is 2^-21 of a cell everywhere.
+*/
+class PackedPositionCodec
+{
+  public:
+    static constexpr int offset_bits = 21;
+    static constexpr std::uint64_t offset_range = std::uint64_t( 1 )
+                                                  << offset_bits;
+    static constexpr std::uint64_t offset_mask = offset_range - 1;
+
+    PackedPositionCodec() = default;
+
+    template <class LocalGridType>
+    PackedPositionCodec( const LocalGridType& local_grid )
+    {
+        const auto& global_mesh = local_grid.globalGrid().globalMesh();
+        auto ghosted_cells = local_grid.indexSpace(
+            Cajita::Ghost(), Cajita::Cell(), Cajita::Global() );
+        int pad = 1;
+
+        int total_bits = 0;
+        for ( int d = 0; d < 3; ++d )
+        {
+            _dx[d] = global_mesh.cellSize( d );
+            _inv_dx[d] = 1.0 / _dx[d];
+            _low[d] = global_mesh.lowCorner( d ) +
+                      ( ghosted_cells.min( d ) - pad ) * _dx[d];
+
+            int extent = ghosted_cells.extent( d ) + 2 * pad;
+            _extent[d] = extent;
+            int bits = 0;
+            while ( ( 1 << bits ) < extent )
+                ++bits;
+            _shift[d] = total_bits;
+            _mask[d] = ( 1u << bits ) - 1u;
+            total_bits += bits;
+        }
+        if ( total_bits > 32 )
+            throw std::runtime_error( "Local grid too large for packed "
+                                      "particle positions" );
+    }
+
+    // Decode the position of a particle in a dimension.
+    KOKKOS_INLINE_FUNCTION
+    double decode( const unsigned cell, const std::uint64_t offsets,
+                   const int d ) const
+    {
+        return _low[d] + cellUnits( cell, offsets, d ) * _dx[d];
+    }
+
+    // Set the position of a particle in a dimension.
+    KOKKOS_INLINE_FUNCTION
+    void set( const double x, const int d, unsigned& cell,
+              std::uint64_t& offsets ) const
+    {
+        encode( ( x - _low[d] ) * _inv_dx[d], d, cell, offsets );
+    }
+
+    // Move a particle in a dimension. The update is done in cell units so
+    // it does not lose precision far from the origin.
+    KOKKOS_INLINE_FUNCTION
+    void add( const double delta, const int d, unsigned& cell,
+              std::uint64_t& offsets ) const
+    {
+        encode( cellUnits( cell, offsets, d ) + delta * _inv_dx[d], d, cell,
+                offsets );
+    }
+
+  private:
+    // Position relative to the low corner of the padded grid in cells.
+    KOKKOS_INLINE_FUNCTION
+    double cellUnits( const unsigned cell, const std::uint64_t offsets,
+                      const int d ) const
+    {
+        unsigned c = ( cell >> _shift[d] ) & _mask[d];
+        std::uint64_t o = ( offsets >> ( offset_bits * d ) ) & offset_mask;
+        return c + o * ( 1.0 / offset_range );
+    }
+
+    // Encode a position in cells. The offset is rounded to the nearest
+    // fixed-point value so decoding and encoding a position is exact.
+    // Positions outside of the padded block, including NaN, abort instead of
+    // wrapping.
+    KOKKOS_INLINE_FUNCTION
+    void encode( const double t, const int d, unsigned& cell,
+                 std::uint64_t& offsets ) const
+    {
+        double c = floor( t );
+        std::uint64_t o = 0;
+        if ( c >= 0.0 && c < _extent[d] )
+            o = static_cast<std::uint64_t>( ( t - c ) * offset_range + 0.5 );
+        if ( offset_range == o )
+        {
+            c += 1.0;
+            o = 0;
+        }
+        if ( !( c >= 0.0 && c < _extent[d] ) )
+            Kokkos::abort( "Particle position outside of the packed range" );
+        cell = ( cell & ~( _mask[d] << _shift[d] ) ) |
+               ( ( static_cast<unsigned>( c ) & _mask[d] ) << _shift[d] );
+        offsets = ( offsets & ~( offset_mask << ( offset_bits * d ) ) ) |
+                  ( o << ( offset_bits * d ) );
+    }
+
+    double _low[3] = { 0.0, 0.0, 0.0 };
+    double _dx[3] = { 1.0, 1.0, 1.0 };
+    double _inv_dx[3] = { 1.0, 1.0, 1.0 };
+    int _extent[3] = { 0, 0, 0 };
+    int _shift[3] = { 0, 0, 0 };
+    unsigned _mask[3] = { 0u, 0u, 0u };
+};
+
+//---------------------------------------------------------------------------//
+// Reference to one component of a packed particle position. Reads decode
+// the component and writes encode it.
+template <class PositionSlice>
+class PackedPositionReference
+{
+  public:
+    KOKKOS_INLINE_FUNCTION
+    PackedPositionReference( const PositionSlice& slice,
+                             const ParticleIndex p, const int d )
+        : _slice( slice )
+        , _p( p )
+        , _d( d )
+    {
+    }
+
+    KOKKOS_INLINE_FUNCTION
+    operator double() const { return _slice.get( _p, _d ); }
+
+    KOKKOS_INLINE_FUNCTION
+    const PackedPositionReference& operator=( const double x ) const
+    {
+        _slice.set( _p, _d, x );
+        return *this;
+    }
+
+    KOKKOS_INLINE_FUNCTION
+    const PackedPositionReference&
+    operator=( const PackedPositionReference& other ) const
+    {
+        _slice.set( _p, _d, static_cast<double>( other ) );
+        return *this;
+    }
+
+    KOKKOS_INLINE_FUNCTION
+    const PackedPositionReference& operator+=( const double delta ) const
+    {
+        _slice.add( _p, _d, delta );
+        return *this;
+    }
+
+    KOKKOS_INLINE_FUNCTION
+    const PackedPositionReference& operator-=( const double delta ) const
+    {
+        _slice.add( _p, _d, -delta );
+        return *this;
+    }
+
+  private:
+    const PositionSlice& _slice;
+    ParticleIndex _p;
+    int _d;
+};
+
+//---------------------------------------------------------------------------//
+/*!
+  \class PackedPositionSlice
+  \brief Position slice over packed particle positions. Indexed like a
+  Cabana position slice so kernels written for absolute positions work
+  unchanged.
+*/
+template <class CellSlice, class OffsetSlice>
+class PackedPositionSlice
+{
+  public:
+    using value_type = double;
+    using device_type = typename CellSlice::device_type;
+    using memory_space = typename CellSlice::memory_space;
+    using execution_space = typename CellSlice::execution_space;
+    using reference_type =
+        PackedPositionReference<PackedPositionSlice<CellSlice, OffsetSlice>>;
+
+    PackedPositionSlice( const CellSlice& cell, const OffsetSlice& offsets,
+                         const PackedPositionCodec& codec )
+        : _cell( cell )
+        , _offsets( offsets )
+        , _codec( codec )
+    {
+    }
+
+    KOKKOS_INLINE_FUNCTION
+    reference_type operator()( const ParticleIndex p, const int d ) const
+    {
+        return reference_type( *this, p, d );
+    }
+
+    KOKKOS_INLINE_FUNCTION
+    double get( const ParticleIndex p, const int d ) const
+    {
+        return _codec.decode( _cell( p ), _offsets( p ), d );
+    }
+
+    KOKKOS_INLINE_FUNCTION
+    void set( const ParticleIndex p, const int d, const double x ) const
+    {
+        _codec.set( x, d, _cell( p ), _offsets( p ) );
+    }
+
+    KOKKOS_INLINE_FUNCTION
+    void add( const ParticleIndex p, const int d, const double delta ) const
+    {
+        _codec.add( delta, d, _cell( p ), _offsets( p ) );
+    }
+
+    KOKKOS_INLINE_FUNCTION
+    std::size_t size() const { return _cell.size(); }
+
+    // Only the component extent is used by the particle writers.
+    KOKKOS_INLINE_FUNCTION
+    std::size_t extent( const std::size_t dim ) const
+    {
+        return ( 2 == dim ) ? 3 : _cell.extent( dim );
+    }
+
+    std::string label() const { return "position"; }
+
+  private:
+    CellSlice _cell;
+    OffsetSlice _offsets;
+    PackedPositionCodec _codec;
+};
+
+//---------------------------------------------------------------------------//
+
+} // end namespace ExaMPM
+
+#endif // EXAMPM_PACKEDPOSITION_HPP
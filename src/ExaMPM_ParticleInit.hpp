@@ -20,53 +20,178 @@
 #include <Kokkos_Core.hpp>
 #include <Kokkos_Random.hpp>
 
+#include <array>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
 namespace ExaMPM
 {
 //---------------------------------------------------------------------------//
-// Filter out empty particles that weren't created.
-template <class CreationView, class ParticleList, class ExecutionSpace>
-void filterEmpties( const ExecutionSpace& exec_space,
-                    const int local_num_create,
-                    const CreationView& particle_created,
-                    ParticleList& particles )
+// Visit the candidate particle positions of a cell. The visitor is called
+// with the position of each candidate in a fixed order.
+template <class LocalMeshType, class Visitor>
+KOKKOS_INLINE_FUNCTION void
+visitCellCandidates( const LocalMeshType& local_mesh, const int i, const int j,
+                     const int k, const int particles_per_cell_dim,
+                     const Visitor& visit )
 {
-    using memory_space = typename CreationView::memory_space;
-
-    // Determine the empty particle positions in the compaction zone.
-    int num_particles = particles.size();
-    Kokkos::View<int*, memory_space> empties(
-        Kokkos::ViewAllocateWithoutInitializing( "empties" ),
-        std::min( num_particles - local_num_create, local_num_create ) );
-    Kokkos::parallel_scan(
-        Kokkos::RangePolicy<ExecutionSpace>( exec_space, 0, local_num_create ),
-        KOKKOS_LAMBDA( const int i, int& count, const bool final_pass ) {
-            if ( !particle_created( i ) )
+    // Get the coordinates of the low cell node.
+    int low_node[3] = { i, j, k };
+    double low_coords[3];
+    local_mesh.coordinates( Cajita::Node(), low_node, low_coords );
+
+    // Get the coordinates of the high cell node.
+    int high_node[3] = { i + 1, j + 1, k + 1 };
+    double high_coords[3];
+    local_mesh.coordinates( Cajita::Node(), high_node, high_coords );
+
+    // Compute the particle spacing in each dimension.
+    double spacing[3] = { ( high_coords[Dim::I] - low_coords[Dim::I] ) /
+                              particles_per_cell_dim,
+                          ( high_coords[Dim::J] - low_coords[Dim::J] ) /
+                              particles_per_cell_dim,
+                          ( high_coords[Dim::K] - low_coords[Dim::K] ) /
+                              particles_per_cell_dim };
+
+    // Particle coordinate.
+    double px[3];
+
+    // Visit the candidates.
+    for ( int ip = 0; ip < particles_per_cell_dim; ++ip )
+        for ( int jp = 0; jp < particles_per_cell_dim; ++jp )
+            for ( int kp = 0; kp < particles_per_cell_dim; ++kp )
             {
-                if ( final_pass )
-                {
-                    empties( count ) = i;
-                }
-                ++count;
+                px[Dim::I] = 0.5 * spacing[Dim::I] + ip * spacing[Dim::I] +
+                             low_coords[Dim::I];
+                px[Dim::J] = 0.5 * spacing[Dim::J] + jp * spacing[Dim::J] +
+                             low_coords[Dim::J];
+                px[Dim::K] = 0.5 * spacing[Dim::K] + kp * spacing[Dim::K] +
+                             low_coords[Dim::K];
+                visit( px );
             }
-        } );
+}
 
-    // Compact the list so the it only has real particles.
-    Kokkos::parallel_scan(
-        Kokkos::RangePolicy<ExecutionSpace>( exec_space, local_num_create,
-                                             num_particles ),
-        KOKKOS_LAMBDA( const int i, int& count, const bool final_pass ) {
-            if ( particle_created( i ) )
-            {
-                if ( final_pass )
-                {
-                    particles.setTuple( empties( count ),
-                                        particles.getTuple( i ) );
-                }
-                ++count;
-            }
-        } );
-    particles.resize( local_num_create );
-    particles.shrinkToFit();
+//---------------------------------------------------------------------------//
+// Detect if an initialization functor exposes a bounding box of the region
+// in which it creates particles via:
+//
+//     Kokkos::Array<double,6> boundingBox() const;
+//
+// The box is ordered as {x_min, y_min, z_min, x_max, y_max, z_max}.
+template <class InitFunctor, class = void>
+struct HasBoundingBox : std::false_type
+{
+};
+
+template <class InitFunctor>
+struct HasBoundingBox<
+    InitFunctor,
+    decltype( std::declval<const InitFunctor&>().boundingBox(), void() )>
+    : std::true_type
+{
+};
+
+// Get the bounding box of a functor that has one.
+template <class InitFunctor>
+Kokkos::Array<double, 6> initBoundingBox( const InitFunctor& create_functor,
+                                          std::true_type )
+{
+    return create_functor.boundingBox();
+}
+
+// Functors without a bounding box may create particles anywhere.
+template <class InitFunctor>
+Kokkos::Array<double, 6> initBoundingBox( const InitFunctor&, std::false_type )
+{
+    double lo = std::numeric_limits<double>::lowest();
+    double hi = std::numeric_limits<double>::max();
+    return { lo, lo, lo, hi, hi, hi };
+}
+
+//---------------------------------------------------------------------------//
+// Detect if an initialization functor needs to be bound to the local grid
+// and memory space before use via:
+//
+//     template <class MemorySpace, class LocalGridType>
+//     BoundFunctor bind( const LocalGridType& local_grid ) const;
+//
+// This lets functors load rank-local data (e.g. a block of a geometry file)
+// into the memory space of the particles. The bound functor is then used in
+// place of the original.
+template <class InitFunctor, class MemorySpace, class LocalGridType,
+          class = void>
+struct HasBind : std::false_type
+{
+};
+
+template <class InitFunctor, class MemorySpace, class LocalGridType>
+struct HasBind<InitFunctor, MemorySpace, LocalGridType,
+               decltype( std::declval<const InitFunctor&>()
+                             .template bind<MemorySpace>(
+                                 std::declval<const LocalGridType&>() ),
+                         void() )> : std::true_type
+{
+};
+
+// Bind a functor that requires it.
+template <class MemorySpace, class InitFunctor, class LocalGridType>
+auto bindInitFunctor( const InitFunctor& create_functor,
+                      const LocalGridType& local_grid, std::true_type )
+    -> decltype( create_functor.template bind<MemorySpace>( local_grid ) )
+{
+    return create_functor.template bind<MemorySpace>( local_grid );
+}
+
+// Other functors are used as-is.
+template <class MemorySpace, class InitFunctor, class LocalGridType>
+InitFunctor bindInitFunctor( const InitFunctor& create_functor,
+                             const LocalGridType&, std::false_type )
+{
+    return create_functor;
+}
+
+//---------------------------------------------------------------------------//
+// Get the local owned cells that overlap a bounding box. The result is empty
+// if the box does not intersect the owned cells.
+template <class LocalGridType>
+Cajita::IndexSpace<3>
+boundedOwnedCells( const LocalGridType& local_grid,
+                   const Kokkos::Array<double, 6>& bounding_box )
+{
+    auto owned_cells =
+        local_grid.indexSpace( Cajita::Own(), Cajita::Cell(), Cajita::Local() );
+    const auto& global_grid = local_grid.globalGrid();
+    const auto& global_mesh = global_grid.globalMesh();
+
+    std::array<long, 3> min;
+    std::array<long, 3> max;
+    for ( int d = 0; d < 3; ++d )
+    {
+        // Owned cell bounds and the offset from global to local indices.
+        double owned_min = owned_cells.min( d );
+        double owned_max = owned_cells.max( d );
+        double offset = owned_min - global_grid.globalOffset( d );
+
+        // Cells touching the box. Clamp in floating point before converting
+        // so unbounded boxes do not overflow.
+        double low = global_mesh.lowCorner( d );
+        double dx = global_mesh.cellSize( d );
+        double box_min =
+            std::floor( ( bounding_box[d] - low ) / dx ) + offset;
+        double box_max =
+            std::floor( ( bounding_box[d + 3] - low ) / dx ) + offset + 1.0;
+        min[d] = static_cast<long>(
+            std::min( std::max( box_min, owned_min ), owned_max ) );
+        max[d] = static_cast<long>(
+            std::min( std::max( box_max, owned_min ), owned_max ) );
+
+        // An inverted box selects no cells.
+        max[d] = std::max( max[d], min[d] );
+    }
+
+    return Cajita::IndexSpace<3>( min, max );
 }
 
 //---------------------------------------------------------------------------//
@@ -80,7 +205,9 @@ void filterEmpties( const ExecutionSpace& exec_space,
   for the create_functor parameter on the signature of this functor.
 
   \tparam ParticleList A Cabana::AoSoA type for holding particles. The tuple
-  type in this AoSoA is the particle type.
+  type in this AoSoA is the particle type. Any list providing the device_type
+  and tuple_type types, resize(), and a device setTuple() may be used instead,
+  e.g. to scatter the created tuples into another storage layout.
 
   \param local_grid The local grid to use for initialization. Particles will
   not be initialized in the halo - only in the owned cells.
@@ -98,6 +225,21 @@ void filterEmpties( const ExecutionSpace& exec_space,
   \param particles The Cabana AoSoA of particles to populate. This will be
   filled with particles and resized to a size equal to the number of particles
   created.
+
+  Particles are created in two passes. The first pass counts the particles
+  created in each cell and scans the counts into cell offsets. The second pass
+  writes each particle directly into an AoSoA of the final size so the
+  initialization never allocates storage for particles that are not created.
+  The create functor is evaluated twice per candidate position and therefore
+  must be deterministic.
+
+  If the create functor provides a boundingBox() only the owned cells
+  overlapping the box are visited and ranks whose cells do not overlap the box
+  skip initialization entirely.
+
+  If the create functor provides a bind() it is first bound to the local grid
+  and the memory space of the particles and the bound functor is used for
+  creation instead.
 */
 template <class ExecSpace, class LocalGridType, class InitFunctor,
           class ParticleList>
@@ -110,101 +252,100 @@ void initializeParticles( const ExecSpace& exec_space,
     // Device type.
     using device_type = typename ParticleList::device_type;
 
+    // Memory space.
+    using memory_space = typename device_type::memory_space;
+
     // Particle type.
     using particle_type = typename ParticleList::tuple_type;
 
+    // Bind the functor to this rank if needed.
+    auto init_functor = bindInitFunctor<memory_space>(
+        create_functor, local_grid,
+        HasBind<InitFunctor, memory_space, LocalGridType>() );
+    using bound_functor = decltype( init_functor );
+
     // Create a local mesh.
     auto local_mesh = Cajita::createLocalMesh<device_type>( local_grid );
 
-    // Get the local set of owned cell indices.
-    auto owned_cells =
-        local_grid.indexSpace( Cajita::Own(), Cajita::Cell(), Cajita::Local() );
+    // Get the local set of owned cell indices that may contain particles.
+    auto init_cells = boundedOwnedCells(
+        local_grid, initBoundingBox( init_functor,
+                                     HasBoundingBox<bound_functor>() ) );
+    int num_cell = init_cells.size();
+    if ( 0 == num_cell )
+    {
+        particles.resize( 0 );
+        return;
+    }
+    int cell_min[3] = { static_cast<int>( init_cells.min( Dim::I ) ),
+                        static_cast<int>( init_cells.min( Dim::J ) ),
+                        static_cast<int>( init_cells.min( Dim::K ) ) };
+    int cell_extent[3] = { static_cast<int>( init_cells.extent( Dim::I ) ),
+                           static_cast<int>( init_cells.extent( Dim::J ) ),
+                           static_cast<int>( init_cells.extent( Dim::K ) ) };
+
+    // Particle creation offset of each visited cell. The last entry holds the
+    // total number of particles created.
+    Kokkos::View<ParticleIndex*, device_type> cell_offset( "cell_offset",
+                                                           num_cell + 1 );
+
+    // Count the particles created in each cell.
+    Kokkos::parallel_for(
+        "init_particles_count",
+        Kokkos::RangePolicy<ExecSpace>( exec_space, 0, num_cell ),
+        KOKKOS_LAMBDA( const int c ) {
+            int i = cell_min[Dim::I] + c % cell_extent[Dim::I];
+            int j = cell_min[Dim::J] + ( c / cell_extent[Dim::I] ) %
+                                           cell_extent[Dim::J];
+            int k = cell_min[Dim::K] +
+                    c / ( cell_extent[Dim::I] * cell_extent[Dim::J] );
 
-    // Allocate enough space for the case the particles consume the entire
-    // local grid.
-    int particles_per_cell = particles_per_cell_dim * particles_per_cell_dim *
-                             particles_per_cell_dim;
-    int num_particles = particles_per_cell * owned_cells.size();
-    particles.resize( num_particles );
-
-    // Creation status.
-    auto particle_created = Kokkos::View<bool*, device_type>(
-        Kokkos::ViewAllocateWithoutInitializing( "particle_created" ),
-        num_particles );
-
-    // Initialize particles.
-    int local_num_create = 0;
-    Kokkos::parallel_reduce(
-        "init_particles_uniform",
-        Cajita::createExecutionPolicy( owned_cells, exec_space ),
-        KOKKOS_LAMBDA( const int i, const int j, const int k,
-                       int& create_count ) {
-            // Compute the owned local cell id.
-            int i_own = i - owned_cells.min( Dim::I );
-            int j_own = j - owned_cells.min( Dim::J );
-            int k_own = k - owned_cells.min( Dim::K );
-            int cell_id =
-                i_own + owned_cells.extent( Dim::I ) *
-                            ( j_own + k_own * owned_cells.extent( Dim::J ) );
-
-            // Get the coordinates of the low cell node.
-            int low_node[3] = { i, j, k };
-            double low_coords[3];
-            local_mesh.coordinates( Cajita::Node(), low_node, low_coords );
-
-            // Get the coordinates of the high cell node.
-            int high_node[3] = { i + 1, j + 1, k + 1 };
-            double high_coords[3];
-            local_mesh.coordinates( Cajita::Node(), high_node, high_coords );
-
-            // Compute the particle spacing in each dimension.
-            double spacing[3] = { ( high_coords[Dim::I] - low_coords[Dim::I] ) /
-                                      particles_per_cell_dim,
-                                  ( high_coords[Dim::J] - low_coords[Dim::J] ) /
-                                      particles_per_cell_dim,
-                                  ( high_coords[Dim::K] - low_coords[Dim::K] ) /
-                                      particles_per_cell_dim };
-
-            // Particle coordinate.
-            double px[3];
-
-            // Particle.
             particle_type particle;
+            int count = 0;
+            visitCellCandidates( local_mesh, i, j, k, particles_per_cell_dim,
+                                 [&]( const double px[3] ) {
+                                     if ( init_functor( px, particle ) )
+                                         ++count;
+                                 } );
+            cell_offset( c ) = count;
+        } );
+
+    // Convert the counts to offsets.
+    Kokkos::parallel_scan(
+        "init_particles_offset",
+        Kokkos::RangePolicy<ExecSpace>( exec_space, 0, num_cell + 1 ),
+        KOKKOS_LAMBDA( const int c, ParticleIndex& offset,
+                       const bool final_pass ) {
+            ParticleIndex count = ( c < num_cell ) ? cell_offset( c ) : 0;
+            if ( final_pass )
+                cell_offset( c ) = offset;
+            offset += count;
+        } );
+
+    // Allocate exactly the number of particles created.
+    ParticleIndex num_create = 0;
+    Kokkos::deep_copy( num_create, Kokkos::subview( cell_offset, num_cell ) );
+    particles.resize( num_create );
+
+    // Create the particles directly in their final location.
+    Kokkos::parallel_for(
+        "init_particles_uniform",
+        Kokkos::RangePolicy<ExecSpace>( exec_space, 0, num_cell ),
+        KOKKOS_LAMBDA( const int c ) {
+            int i = cell_min[Dim::I] + c % cell_extent[Dim::I];
+            int j = cell_min[Dim::J] + ( c / cell_extent[Dim::I] ) %
+                                           cell_extent[Dim::J];
+            int k = cell_min[Dim::K] +
+                    c / ( cell_extent[Dim::I] * cell_extent[Dim::J] );
 
-            // Create particles.
-            for ( int ip = 0; ip < particles_per_cell_dim; ++ip )
-                for ( int jp = 0; jp < particles_per_cell_dim; ++jp )
-                    for ( int kp = 0; kp < particles_per_cell_dim; ++kp )
-                    {
-                        // Local particle id.
-                        int pid = cell_id * particles_per_cell + ip +
-                                  particles_per_cell_dim *
-                                      ( jp + particles_per_cell_dim * kp );
-
-                        // Set the particle position.
-                        px[Dim::I] = 0.5 * spacing[Dim::I] +
-                                     ip * spacing[Dim::I] + low_coords[Dim::I];
-                        px[Dim::J] = 0.5 * spacing[Dim::J] +
-                                     jp * spacing[Dim::J] + low_coords[Dim::J];
-                        px[Dim::K] = 0.5 * spacing[Dim::K] +
-                                     kp * spacing[Dim::K] + low_coords[Dim::K];
-
-                        // Create a new particle.
-                        particle_created( pid ) =
-                            create_functor( px, particle );
-
-                        // If we created a new particle insert it into the list.
-                        if ( particle_created( pid ) )
-                        {
-                            particles.setTuple( pid, particle );
-                            ++create_count;
-                        }
-                    }
-        },
-        local_num_create );
-
-    // Filter empties.
-    filterEmpties( exec_space, local_num_create, particle_created, particles );
+            particle_type particle;
+            ParticleIndex pid = cell_offset( c );
+            visitCellCandidates( local_mesh, i, j, k, particles_per_cell_dim,
+                                 [&]( const double px[3] ) {
+                                     if ( init_functor( px, particle ) )
+                                         particles.setTuple( pid++, particle );
+                                 } );
+        } );
 }
 
 //---------------------------------------------------------------------------//
@@ -0,0 +1,612 @@
+/****************************************************************************
+ * Copyright (c) 2018-2020 by the ExaMPM authors                            *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the ExaMPM library. ExaMPM is distributed under a   *
+ * BSD 3-clause license. For the licensing terms see the LICENSE file in    *
+ * the top-level directory.                                                 *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#ifndef EXAMPM_PARTICLESTORAGE_HPP
+#define EXAMPM_PARTICLESTORAGE_HPP
+
+#include <ExaMPM_FirstTouch.hpp>
+#include <ExaMPM_PackedPosition.hpp>
+#include <ExaMPM_ParticleInit.hpp>
+
+#include <Cabana_Core.hpp>
+
+#include <Cajita.hpp>
+
+#include <Kokkos_Core.hpp>
+
+#include <mpi.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
+namespace ExaMPM
+{
+//---------------------------------------------------------------------------//
+// Particle members written by the initialization functors: affine matrix,
+// velocity, position, mass, volume, and deformation gradient determinant.
+using ParticleInitMembers =
+    Cabana::MemberTypes<double[3][3], double[3], double[3], double, double,
+                        double>;
+
+//---------------------------------------------------------------------------//
+// Default AoSoA vector length of a memory space.
+template <class MemorySpace>
+struct DefaultVectorLength
+{
+    static constexpr int value = Cabana::Impl::PerformanceTraits<
+        typename MemorySpace::execution_space>::vector_length;
+};
+
+//---------------------------------------------------------------------------//
+// Members of the main particle list and their indices. Members stored
+// elsewhere have index 0 and are never sliced from the list.
+template <bool SplitPosition, bool UniformMass>
+struct ParticleListMembers;
+
+template <>
+struct ParticleListMembers<false, false>
+{
+    using type = ParticleInitMembers;
+    static constexpr int affine = 0;
+    static constexpr int velocity = 1;
+    static constexpr int position = 2;
+    static constexpr int mass = 3;
+    static constexpr int volume = 4;
+    static constexpr int j = 5;
+};
+
+template <>
+struct ParticleListMembers<true, false>
+{
+    using type =
+        Cabana::MemberTypes<double[3][3], double[3], double, double, double>;
+    static constexpr int affine = 0;
+    static constexpr int velocity = 1;
+    static constexpr int position = 0;
+    static constexpr int mass = 2;
+    static constexpr int volume = 3;
+    static constexpr int j = 4;
+};
+
+template <>
+struct ParticleListMembers<false, true>
+{
+    using type =
+        Cabana::MemberTypes<double[3][3], double[3], double[3], double>;
+    static constexpr int affine = 0;
+    static constexpr int velocity = 1;
+    static constexpr int position = 2;
+    static constexpr int mass = 0;
+    static constexpr int volume = 0;
+    static constexpr int j = 3;
+};
+
+template <>
+struct ParticleListMembers<true, true>
+{
+    using type = Cabana::MemberTypes<double[3][3], double[3], double>;
+    static constexpr int affine = 0;
+    static constexpr int velocity = 1;
+    static constexpr int position = 0;
+    static constexpr int mass = 0;
+    static constexpr int volume = 0;
+    static constexpr int j = 2;
+};
+
+//---------------------------------------------------------------------------//
+/*!
+  \class UniformParticleField
+  \brief Read-only scalar particle field with the same value on every
+  particle. Indexed like a slice so the transfer kernels can use it in place
+  of a stored member.
+*/
+template <class MemorySpace>
+class UniformParticleField
+{
+  public:
+    using memory_space = MemorySpace;
+
+    UniformParticleField( const double value, const std::size_t size )
+        : _value( value )
+        , _size( size )
+    {
+    }
+
+    KOKKOS_INLINE_FUNCTION
+    double operator()( const ParticleIndex ) const { return _value; }
+
+    KOKKOS_INLINE_FUNCTION
+    std::size_t size() const { return _size; }
+
+  private:
+    double _value;
+    std::size_t _size;
+};
+
+//---------------------------------------------------------------------------//
+// Store a scalar member of a particle. Uniform fields are not stored.
+template <class Slice>
+KOKKOS_INLINE_FUNCTION void storeParticleScalar( const Slice& slice,
+                                                 const ParticleIndex p,
+                                                 const double value )
+{
+    slice( p ) = value;
+}
+
+template <class MemorySpace>
+KOKKOS_INLINE_FUNCTION void
+storeParticleScalar( const UniformParticleField<MemorySpace>&,
+                     const ParticleIndex, const double )
+{
+}
+
+//---------------------------------------------------------------------------//
+// Atomically raise a value to at least a bound.
+KOKKOS_INLINE_FUNCTION
+void atomicRaise( double* value, const double bound )
+{
+    double old = *value;
+    while ( old < bound )
+    {
+        double prev = Kokkos::atomic_compare_exchange( value, old, bound );
+        if ( prev == old )
+            break;
+        old = prev;
+    }
+}
+
+//---------------------------------------------------------------------------//
+/*!
+  \class ParticleStorage
+  \brief Particle containers of the problem manager.
+
+  By default all particle members are stored in one AoSoA. When SplitPosition
+  is true the positions are stored in a separate hot AoSoA so kernels that
+  only read the positions (the position correction and the migration check)
+  stream 24 bytes per particle instead of the full 144-byte tuple.
+
+  When UniformMass is true every particle must be created with the same mass
+  and volume. They are kept as two constants instead of particle members,
+  which removes 16 bytes per particle from the storage, the migration, and
+  the p2g loads.
+
+  When PackedPosition is true the split positions are stored in the 12-byte
+  cell-relative fixed-point format of PackedPositionCodec and decoded on
+  access.
+
+  When first touch is enabled the containers are reallocated after
+  initialization, and after every migration that moves particles, and
+  written with the particle loop policy so on host backends each thread's
+  particles are placed on its own NUMA node.
+*/
+template <class MemorySpace, int VectorLength, bool SplitPosition,
+          bool UniformMass, bool PackedPosition>
+class ParticleStorage
+{
+    static_assert( SplitPosition || !PackedPosition,
+                   "Packed particle positions must be split" );
+
+  public:
+    using members = ParticleListMembers<SplitPosition, UniformMass>;
+
+    using particle_list =
+        Cabana::AoSoA<typename members::type, MemorySpace, VectorLength>;
+
+    // Packed positions: cell index and fixed-point offsets.
+    using packed_list =
+        Cabana::AoSoA<Cabana::MemberTypes<unsigned, std::uint64_t>,
+                      MemorySpace, VectorLength>;
+
+    // Only allocated when the positions are split.
+    using position_list = typename std::conditional<
+        PackedPosition, packed_list,
+        Cabana::AoSoA<Cabana::MemberTypes<double[3]>, MemorySpace,
+                      VectorLength>>::type;
+
+    using packed_position_slice = PackedPositionSlice<
+        typename packed_list::template member_slice_type<0>,
+        typename packed_list::template member_slice_type<1>>;
+
+    using uniform_field = UniformParticleField<MemorySpace>;
+
+    using affine_slice =
+        typename particle_list::template member_slice_type<members::affine>;
+    using velocity_slice =
+        typename particle_list::template member_slice_type<members::velocity>;
+    using position_slice = typename std::conditional<
+        PackedPosition, packed_position_slice,
+        typename std::conditional<
+            SplitPosition,
+            typename position_list::template member_slice_type<0>,
+            typename particle_list::template member_slice_type<
+                members::position>>::type>::type;
+    using mass_slice = typename std::conditional<
+        UniformMass, uniform_field,
+        typename particle_list::template member_slice_type<
+            members::mass>>::type;
+    using volume_slice = typename std::conditional<
+        UniformMass, uniform_field,
+        typename particle_list::template member_slice_type<
+            members::volume>>::type;
+    using j_slice =
+        typename particle_list::template member_slice_type<members::j>;
+
+    ParticleStorage( const bool first_touch = false )
+        : _particles( "particles" )
+        , _positions( "positions" )
+        , _uniform_mass( 0.0 )
+        , _uniform_volume( 0.0 )
+        , _first_touch( first_touch )
+    {
+    }
+
+    template <class ExecutionSpace, class LocalGridType, class InitFunc>
+    void initialize( const ExecutionSpace& exec_space,
+                     const LocalGridType& local_grid,
+                     const int particles_per_cell,
+                     const InitFunc& create_functor )
+    {
+        using in_place =
+            std::integral_constant<bool, !SplitPosition && !UniformMass>;
+        initialize( exec_space, local_grid, particles_per_cell,
+                    create_functor, in_place() );
+        if ( _first_touch )
+            firstTouch( exec_space );
+    }
+
+    std::size_t size() const { return _particles.size(); }
+
+    affine_slice affine() const
+    {
+        return Cabana::slice<members::affine>( _particles, "affine" );
+    }
+
+    velocity_slice velocity() const
+    {
+        return Cabana::slice<members::velocity>( _particles, "velocity" );
+    }
+
+    position_slice position() const { return position( position_tag() ); }
+
+    mass_slice mass() const
+    {
+        return mass( std::integral_constant<bool, UniformMass>() );
+    }
+
+    volume_slice volume() const
+    {
+        return volume( std::integral_constant<bool, UniformMass>() );
+    }
+
+    j_slice j() const { return Cabana::slice<members::j>( _particles, "J" ); }
+
+    // Migrate the particles if any is close enough to the edge of the
+    // ghosted domain to require communication. Only the positions are read
+    // to decide.
+    template <class LocalGridType>
+    void migrate( const LocalGridType& local_grid,
+                  const int minimum_halo_width )
+    {
+        auto x_p = position();
+        if ( !needsMigration( local_grid, minimum_halo_width, x_p ) )
+            return;
+        migrate( local_grid, x_p, position_tag() );
+
+        // Migration removes the sent particles and appends the received ones
+        // so the index range of every thread shifts. The containers are
+        // touched again after each migration so the pages follow.
+        if ( _first_touch )
+            firstTouch( typename MemorySpace::execution_space() );
+    }
+
+  private:
+    // Position storage: 0 with the other members, 1 split, and 2 packed.
+    using position_tag =
+        std::integral_constant<int, PackedPosition ? 2 : SplitPosition>;
+
+    // The storage layout is the init layout so the particles are created in
+    // place.
+    template <class ExecutionSpace, class LocalGridType, class InitFunc>
+    void initialize( const ExecutionSpace& exec_space,
+                     const LocalGridType& local_grid,
+                     const int particles_per_cell,
+                     const InitFunc& create_functor, std::true_type )
+    {
+        initializeParticles( exec_space, local_grid, particles_per_cell,
+                             create_functor, _particles );
+    }
+
+    // Particle list written by initializeParticles. The functors create full
+    // particle tuples which are scattered directly into the storage layout.
+    // With uniform mass the bounds of the created masses and volumes are
+    // recorded instead so they can be checked once creation is done. The
+    // minima are negated so all bounds are raised.
+    struct InitWriter
+    {
+        using device_type = typename particle_list::device_type;
+        using tuple_type = Cabana::Tuple<ParticleInitMembers>;
+
+        ParticleStorage* storage;
+        affine_slice B_p;
+        velocity_slice u_p;
+        position_slice x_p;
+        mass_slice m_p;
+        volume_slice v_p;
+        j_slice j_p;
+        Kokkos::View<double[4], MemorySpace> bounds;
+
+        explicit InitWriter( ParticleStorage& s )
+            : storage( &s )
+            , B_p( s.affine() )
+            , u_p( s.velocity() )
+            , x_p( s.position() )
+            , m_p( s.mass() )
+            , v_p( s.volume() )
+            , j_p( s.j() )
+            , bounds( "uniform_mass_bounds" )
+        {
+            Kokkos::deep_copy( bounds, std::numeric_limits<double>::lowest() );
+        }
+
+        void resize( const ParticleIndex n )
+        {
+            storage->_particles.resize( n );
+            if ( SplitPosition )
+                storage->_positions.resize( n );
+            B_p = storage->affine();
+            u_p = storage->velocity();
+            x_p = storage->position();
+            m_p = storage->mass();
+            v_p = storage->volume();
+            j_p = storage->j();
+        }
+
+        KOKKOS_INLINE_FUNCTION
+        void setTuple( const ParticleIndex p, const tuple_type& t ) const
+        {
+            for ( int d0 = 0; d0 < 3; ++d0 )
+                for ( int d1 = 0; d1 < 3; ++d1 )
+                    B_p( p, d0, d1 ) = Cabana::get<0>( t, d0, d1 );
+            for ( int d = 0; d < 3; ++d )
+            {
+                u_p( p, d ) = Cabana::get<1>( t, d );
+                x_p( p, d ) = Cabana::get<2>( t, d );
+            }
+            storeParticleScalar( m_p, p, Cabana::get<3>( t ) );
+            storeParticleScalar( v_p, p, Cabana::get<4>( t ) );
+            j_p( p ) = Cabana::get<5>( t );
+            if ( UniformMass )
+            {
+                atomicRaise( &bounds( 0 ), -Cabana::get<3>( t ) );
+                atomicRaise( &bounds( 1 ), Cabana::get<3>( t ) );
+                atomicRaise( &bounds( 2 ), -Cabana::get<4>( t ) );
+                atomicRaise( &bounds( 3 ), Cabana::get<4>( t ) );
+            }
+        }
+    };
+
+    template <class ExecutionSpace, class LocalGridType, class InitFunc>
+    void initialize( const ExecutionSpace& exec_space,
+                     const LocalGridType& local_grid,
+                     const int particles_per_cell,
+                     const InitFunc& create_functor, std::false_type )
+    {
+        if ( PackedPosition )
+            _codec = PackedPositionCodec( local_grid );
+
+        InitWriter writer( *this );
+        initializeParticles( exec_space, local_grid, particles_per_cell,
+                             create_functor, writer );
+        exec_space.fence();
+
+        if ( UniformMass )
+        {
+            auto local_bounds = Kokkos::create_mirror_view_and_copy(
+                Kokkos::HostSpace(), writer.bounds );
+            setUniformMass( local_bounds.data(),
+                            local_grid.globalGrid().comm() );
+        }
+    }
+
+    template <class ExecutionSpace>
+    void firstTouch( const ExecutionSpace& exec_space )
+    {
+        firstTouchParticles( exec_space, _particles );
+        if ( SplitPosition )
+            firstTouchParticles( exec_space, _positions );
+    }
+
+    // Find the global particle mass and volume from the local bounds of the
+    // created particles. Every particle must have the same values.
+    void setUniformMass( const double local_bounds[4], MPI_Comm comm )
+    {
+        double bounds[4];
+        MPI_Allreduce( local_bounds, bounds, 4, MPI_DOUBLE, MPI_MAX, comm );
+
+        // No particles were created on any rank.
+        if ( bounds[1] < -bounds[0] )
+        {
+            _uniform_mass = 0.0;
+            _uniform_volume = 0.0;
+            return;
+        }
+
+        if ( -bounds[0] != bounds[1] || -bounds[2] != bounds[3] )
+            throw std::runtime_error(
+                "Uniform particle mass requires all particles to have the "
+                "same mass and volume" );
+
+        _uniform_mass = bounds[1];
+        _uniform_volume = bounds[3];
+    }
+
+    packed_position_slice position( std::integral_constant<int, 2> ) const
+    {
+        return packed_position_slice( Cabana::slice<0>( _positions, "cell" ),
+                                      Cabana::slice<1>( _positions, "offset" ),
+                                      _codec );
+    }
+
+    typename position_list::template member_slice_type<0>
+        position( std::integral_constant<int, 1> ) const
+    {
+        return Cabana::slice<0>( _positions, "position" );
+    }
+
+    typename particle_list::template member_slice_type<members::position>
+        position( std::integral_constant<int, 0> ) const
+    {
+        return Cabana::slice<members::position>( _particles, "position" );
+    }
+
+    uniform_field mass( std::true_type ) const
+    {
+        return uniform_field( _uniform_mass, _particles.size() );
+    }
+
+    typename particle_list::template member_slice_type<members::mass>
+        mass( std::false_type ) const
+    {
+        return Cabana::slice<members::mass>( _particles, "mass" );
+    }
+
+    uniform_field volume( std::true_type ) const
+    {
+        return uniform_field( _uniform_volume, _particles.size() );
+    }
+
+    typename particle_list::template member_slice_type<members::volume>
+        volume( std::false_type ) const
+    {
+        return Cabana::slice<members::volume>( _particles, "volume" );
+    }
+
+    // Check if any particle on any rank is close enough to the edge of the
+    // ghosted domain to require communication.
+    template <class LocalGridType, class PositionSlice>
+    bool needsMigration( const LocalGridType& local_grid,
+                         const int minimum_halo_width,
+                         const PositionSlice& x_p ) const
+    {
+        using execution_space = typename MemorySpace::execution_space;
+
+        auto local_mesh =
+            Cajita::createLocalMesh<execution_space>( local_grid );
+        double dx = local_grid.globalGrid().globalMesh().cellSize( 0 );
+        Kokkos::Array<double, 3> local_low;
+        Kokkos::Array<double, 3> local_high;
+        for ( int d = 0; d < 3; ++d )
+        {
+            local_low[d] = local_mesh.lowCorner( Cajita::Ghost(), d ) +
+                           minimum_halo_width * dx;
+            local_high[d] = local_mesh.highCorner( Cajita::Ghost(), d ) -
+                            minimum_halo_width * dx;
+        }
+
+        long local_count = 0;
+        Kokkos::parallel_reduce(
+            "particle_migrate_count",
+            ParticleRangePolicy<execution_space>( 0, size() ),
+            KOKKOS_LAMBDA( const ParticleIndex p, long& count ) {
+                for ( int d = 0; d < 3; ++d )
+                    if ( x_p( p, d ) < local_low[d] ||
+                         x_p( p, d ) > local_high[d] )
+                    {
+                        ++count;
+                        break;
+                    }
+            },
+            local_count );
+        long global_count;
+        MPI_Allreduce( &local_count, &global_count, 1, MPI_LONG, MPI_SUM,
+                       local_grid.globalGrid().comm() );
+        return global_count > 0;
+    }
+
+    // Positions stored with the other members.
+    template <class LocalGridType, class PositionSlice>
+    void migrate( const LocalGridType& local_grid, PositionSlice& x_p,
+                  std::integral_constant<int, 0> )
+    {
+        auto distributor =
+            Cajita::createParticleGridDistributor( local_grid, x_p );
+        Cabana::migrate( distributor, _particles );
+    }
+
+    // Migrate both containers with the same distributor.
+    template <class LocalGridType, class PositionSlice>
+    void migrate( const LocalGridType& local_grid, PositionSlice& x_p,
+                  std::integral_constant<int, 1> )
+    {
+        auto distributor =
+            Cajita::createParticleGridDistributor( local_grid, x_p );
+        Cabana::migrate( distributor, _positions );
+        Cabana::migrate( distributor, _particles );
+    }
+
+    // The distributor needs absolute positions and shifts them across
+    // periodic boundaries so the packed positions are decoded, migrated
+    // with the particles, and encoded again. Encoding a decoded position is
+    // exact. The packed values are all overwritten so they are not sent.
+    template <class LocalGridType, class PositionSlice>
+    void migrate( const LocalGridType& local_grid, const PositionSlice& x_p,
+                  std::integral_constant<int, 2> )
+    {
+        using execution_space = typename MemorySpace::execution_space;
+
+        Cabana::AoSoA<Cabana::MemberTypes<double[3]>, MemorySpace,
+                      VectorLength>
+            decoded( "decoded_positions", size() );
+        auto x_d = Cabana::slice<0>( decoded );
+        Kokkos::parallel_for(
+            "decode_positions",
+            ParticleRangePolicy<execution_space>( 0, size() ),
+            KOKKOS_LAMBDA( const ParticleIndex p ) {
+                for ( int d = 0; d < 3; ++d )
+                    x_d( p, d ) = x_p( p, d );
+            } );
+
+        auto distributor =
+            Cajita::createParticleGridDistributor( local_grid, x_d );
+        Cabana::migrate( distributor, decoded );
+        Cabana::migrate( distributor, _particles );
+        _positions.resize( decoded.size() );
+
+        // The packed cells are relative to the local grid so encode with a
+        // codec built from it.
+        _codec = PackedPositionCodec( local_grid );
+        x_d = Cabana::slice<0>( decoded );
+        auto x_e = position();
+        Kokkos::parallel_for(
+            "encode_positions",
+            ParticleRangePolicy<execution_space>( 0, size() ),
+            KOKKOS_LAMBDA( const ParticleIndex p ) {
+                for ( int d = 0; d < 3; ++d )
+                    x_e( p, d ) = x_d( p, d );
+            } );
+    }
+
+    particle_list _particles;
+    position_list _positions;
+    PackedPositionCodec _codec;
+    double _uniform_mass;
+    double _uniform_volume;
+    bool _first_touch;
+};
+
+//---------------------------------------------------------------------------//
+
+} // end namespace ExaMPM
+
+#endif // EXAMPM_PARTICLESTORAGE_HPP
@@ -12,13 +12,20 @@
 #ifndef EXAMPM_PROBLEMMANAGER_HPP
 #define EXAMPM_PROBLEMMANAGER_HPP
 
+#include <ExaMPM_Autotune.hpp>
+#include <ExaMPM_FirstTouch.hpp>
+#include <ExaMPM_Halo.hpp>
 #include <ExaMPM_Mesh.hpp>
-#include <ExaMPM_ParticleInit.hpp>
+#include <ExaMPM_ParticleStorage.hpp>
+#include <ExaMPM_ScatterView.hpp>
+#include <ExaMPM_SolverOptions.hpp>
 
 #include <Cabana_Core.hpp>
 
 #include <Cajita.hpp>
 
+#include <algorithm>
+#include <cstdio>
 #include <memory>
 
 namespace ExaMPM
@@ -78,18 +85,34 @@ struct Mark
 } // end namespace Field.
 
 //---------------------------------------------------------------------------//
-template <class MemorySpace>
+/*!
+  \class ProblemManager
+  \brief Particle and grid fields of the problem.
+
+  VectorLength is the AoSoA vector length of the particles. If SplitPosition
+  is true the particle positions are stored apart from the other members. If
+  UniformMass is true all particles share a single mass and volume. If
+  PackedPosition is true the split positions are stored as cell-relative
+  fixed-point values.
+*/
+template <class MemorySpace,
+          int VectorLength = DefaultVectorLength<MemorySpace>::value,
+          bool SplitPosition = false, bool UniformMass = false,
+          bool PackedPosition = false>
 class ProblemManager
 {
   public:
     using memory_space = MemorySpace;
     using execution_space = typename memory_space::execution_space;
 
-    using particle_members =
-        Cabana::MemberTypes<double[3][3], double[3], double[3], double, double,
-                            double>;
-    using particle_list = Cabana::AoSoA<particle_members, MemorySpace>;
-    using particle_type = typename particle_list::tuple_type;
+    static constexpr int vector_length = VectorLength;
+    static constexpr bool split_position = SplitPosition;
+    static constexpr bool uniform_mass = UniformMass;
+    static constexpr bool packed_position = PackedPosition;
+
+    using particle_storage =
+        ParticleStorage<MemorySpace, VectorLength, SplitPosition, UniformMass,
+                        PackedPosition>;
 
     using node_array = Cajita::Array<double, Cajita::Node,
                                      Cajita::UniformMesh<double>, MemorySpace>;
@@ -97,8 +120,23 @@ class ProblemManager
     using cell_array = Cajita::Array<double, Cajita::Cell,
                                      Cajita::UniformMesh<double>, MemorySpace>;
 
+    using mark_array = Cajita::Array<unsigned char, Cajita::Cell,
+                                     Cajita::UniformMesh<double>, MemorySpace>;
+
     using halo = Cajita::Halo<MemorySpace>;
 
+    using grid_halo = GridHalo<MemorySpace>;
+
+    template <class StrategyTag>
+    using node_scatter_view =
+        typename ScatterViewType<typename node_array::view_type,
+                                 StrategyTag>::type;
+
+    template <class StrategyTag>
+    using cell_scatter_view =
+        typename ScatterViewType<typename cell_array::view_type,
+                                 StrategyTag>::type;
+
     using mesh_type = Mesh<MemorySpace>;
 
     template <class InitFunc, class ExecutionSpace>
@@ -106,16 +144,18 @@ class ProblemManager
                     const std::shared_ptr<mesh_type>& mesh,
                     const InitFunc& create_functor,
                     const int particles_per_cell, const double bulk_modulus,
-                    const double rho, const double gamma, const double kappa )
+                    const double rho, const double gamma, const double kappa,
+                    const SolverOptions& options = SolverOptions() )
         : _mesh( mesh )
         , _bulk_modulus( bulk_modulus )
         , _rho( rho )
         , _gamma( gamma )
         , _kappa( kappa )
-        , _particles( "particles" )
+        , _options( options )
+        , _particles( options.numa_first_touch )
     {
-        initializeParticles( exec_space, *( _mesh->localGrid() ),
-                             particles_per_cell, create_functor, _particles );
+        _particles.initialize( exec_space, *( _mesh->localGrid() ),
+                               particles_per_cell, create_functor );
 
         auto node_vector_layout =
             Cajita::createArrayLayout( _mesh->localGrid(), 3, Cajita::Node() );
@@ -124,21 +164,31 @@ class ProblemManager
         auto cell_scalar_layout =
             Cajita::createArrayLayout( _mesh->localGrid(), 1, Cajita::Cell() );
 
-        _momentum = Cajita::createArray<double, MemorySpace>(
-            "momentum", node_vector_layout );
-        _mass = Cajita::createArray<double, MemorySpace>( "mass",
-                                                          node_scalar_layout );
-        _force = Cajita::createArray<double, MemorySpace>( "force",
-                                                           node_vector_layout );
-        _velocity = Cajita::createArray<double, MemorySpace>(
-            "velocity", node_vector_layout );
-        _position_correction = Cajita::createArray<double, MemorySpace>(
-            "position_correction", node_vector_layout );
-        _density = Cajita::createArray<double, MemorySpace>(
-            "density", cell_scalar_layout );
-
-        _mark = Cajita::createArray<double, MemorySpace>( "mark",
-                                                          cell_scalar_layout );
+        bool first_touch = _options.numa_first_touch;
+        _momentum = createGridArray<double, MemorySpace>(
+            exec_space, "momentum", node_vector_layout, first_touch );
+        _mass = createGridArray<double, MemorySpace>(
+            exec_space, "mass", node_scalar_layout, first_touch );
+        _force = createGridArray<double, MemorySpace>(
+            exec_space, "force", node_vector_layout, first_touch );
+        if ( _options.alias_node_arrays )
+        {
+            _velocity = _momentum;
+            _position_correction = _force;
+        }
+        else
+        {
+            _velocity = createGridArray<double, MemorySpace>(
+                exec_space, "velocity", node_vector_layout, first_touch );
+            _position_correction = createGridArray<double, MemorySpace>(
+                exec_space, "position_correction", node_vector_layout,
+                first_touch );
+        }
+        _density = createGridArray<double, MemorySpace>(
+            exec_space, "density", cell_scalar_layout, first_touch );
+
+        _mark = createGridArray<unsigned char, MemorySpace>(
+            exec_space, "mark", cell_scalar_layout, first_touch );
 
         _node_vector_halo = Cajita::createHalo<double, MemorySpace>(
             *node_vector_layout, Cajita::FullHaloPattern() );
@@ -146,6 +196,57 @@ class ProblemManager
             *node_scalar_layout, Cajita::FullHaloPattern() );
         _cell_scalar_halo = Cajita::createHalo<double, MemorySpace>(
             *cell_scalar_layout, Cajita::FullHaloPattern() );
+
+        // Fused node exchanges are only available when the owned blocks are
+        // large enough. Otherwise they fall back to a scatter followed by a
+        // gather.
+        _node_grid_halo = std::make_shared<grid_halo>( *( _mesh->localGrid() ),
+                                                       Cajita::Node() );
+        _cell_grid_halo = std::make_shared<grid_halo>( *( _mesh->localGrid() ),
+                                                       Cajita::Cell() );
+
+        auto comm = _mesh->localGrid()->globalGrid().comm();
+        _autotuner = std::make_shared<Autotuner>( _options, comm );
+
+        // Select the scatter strategy of each grid location and create the
+        // scatter views once. The transfers reset them every step.
+        int num_update = std::min( _particles.size(), std::size_t( 1 << 20 ) );
+        int concurrency = ExecutionSpace::concurrency();
+
+        // The force is only scattered by the APIC transfer. The MLS transfer
+        // includes it in the momentum.
+        bool mls = ( TransferScheme::MLS == _options.transfer_scheme );
+        int num_node_vector = mls ? 1 : 2;
+        std::size_t node_bytes = ( num_node_vector * _momentum->view().size() +
+                                   _mass->view().size() ) *
+                                 sizeof( double );
+        std::size_t cell_bytes = _density->view().size() * sizeof( double );
+        _node_scatter_duplicated = selectScatterDuplication(
+            exec_space, _momentum->view(), concurrency * node_bytes,
+            num_update, _options, comm );
+        _cell_scatter_duplicated = selectScatterDuplication(
+            exec_space, _density->view(), concurrency * cell_bytes,
+            num_update, _options, comm );
+        _node_scatter_bytes =
+            _node_scatter_duplicated ? concurrency * node_bytes : 0;
+        _cell_scatter_bytes =
+            _cell_scatter_duplicated ? concurrency * cell_bytes : 0;
+
+        // With first touch the duplicated copies are placed by the reset in
+        // the ScatterView constructor. It is a range kernel over the copies
+        // in order with the same static schedule as the particle loops, so
+        // with the threads bound in order each copy is first written by the
+        // thread whose unique token selects it in the transfers. Kokkos
+        // cannot allocate the copies without that reset, so they are not
+        // touched separately.
+        if ( _node_scatter_duplicated )
+            createScatterViews( Location::Node(), _duplicated_scatter_views );
+        else
+            createScatterViews( Location::Node(), _atomic_scatter_views );
+        if ( _cell_scatter_duplicated )
+            createScatterViews( Location::Cell(), _duplicated_scatter_views );
+        else
+            createScatterViews( Location::Cell(), _atomic_scatter_views );
     }
 
     std::size_t numParticle() const { return _particles.size(); }
@@ -160,40 +261,42 @@ class ProblemManager
 
     double kappa() const { return _kappa; }
 
-    typename particle_list::template member_slice_type<0>
+    const SolverOptions& options() const { return _options; }
+
+    typename particle_storage::affine_slice
         get( Location::Particle, Field::Affine ) const
     {
-        return Cabana::slice<0>( _particles, "affine" );
+        return _particles.affine();
     }
 
-    typename particle_list::template member_slice_type<1>
+    typename particle_storage::velocity_slice
         get( Location::Particle, Field::Velocity ) const
     {
-        return Cabana::slice<1>( _particles, "velocity" );
+        return _particles.velocity();
     }
 
-    typename particle_list::template member_slice_type<2>
+    typename particle_storage::position_slice
         get( Location::Particle, Field::Position ) const
     {
-        return Cabana::slice<2>( _particles, "position" );
+        return _particles.position();
     }
 
-    typename particle_list::template member_slice_type<3>
+    typename particle_storage::mass_slice
         get( Location::Particle, Field::Mass ) const
     {
-        return Cabana::slice<3>( _particles, "mass" );
+        return _particles.mass();
     }
 
-    typename particle_list::template member_slice_type<4>
+    typename particle_storage::volume_slice
         get( Location::Particle, Field::Volume ) const
     {
-        return Cabana::slice<4>( _particles, "volume" );
+        return _particles.volume();
     }
 
-    typename particle_list::template member_slice_type<5>
+    typename particle_storage::j_slice
         get( Location::Particle, Field::J ) const
     {
-        return Cabana::slice<5>( _particles, "J" );
+        return _particles.j();
     }
 
     typename node_array::view_type get( Location::Node, Field::Momentum ) const
@@ -227,63 +330,257 @@ class ProblemManager
         return _density->view();
     }
 
-    typename cell_array::view_type get( Location::Cell, Field::Mark ) const
+    typename mark_array::view_type get( Location::Cell, Field::Mark ) const
     {
         return _mark->view();
     }
 
+    // Launch parameter tuning of the grid and particle kernels.
+    Autotuner& autotuner() const { return *_autotuner; }
+
+    // Scatter views. Only the views of the strategy selected for a location
+    // are allocated.
+
+    bool scatterDuplicated( Location::Node ) const
+    {
+        return _node_scatter_duplicated;
+    }
+
+    bool scatterDuplicated( Location::Cell ) const
+    {
+        return _cell_scatter_duplicated;
+    }
+
+    template <class StrategyTag>
+    node_scatter_view<StrategyTag> getScatter( Location::Node, Field::Momentum,
+                                               StrategyTag tag ) const
+    {
+        return scatterViews( tag ).momentum;
+    }
+
+    template <class StrategyTag>
+    node_scatter_view<StrategyTag> getScatter( Location::Node, Field::Mass,
+                                               StrategyTag tag ) const
+    {
+        return scatterViews( tag ).mass;
+    }
+
+    // Empty with the MLS transfer.
+    template <class StrategyTag>
+    node_scatter_view<StrategyTag> getScatter( Location::Node, Field::Force,
+                                               StrategyTag tag ) const
+    {
+        return scatterViews( tag ).force;
+    }
+
+    template <class StrategyTag>
+    cell_scatter_view<StrategyTag> getScatter( Location::Cell, Field::Density,
+                                               StrategyTag tag ) const
+    {
+        return scatterViews( tag ).density;
+    }
+
+    // Print the selected scatter strategies and the largest memory used by
+    // their copies on any rank.
+    void reportScatterStrategy() const
+    {
+        auto comm = _mesh->localGrid()->globalGrid().comm();
+        unsigned long local_bytes[2] = { _node_scatter_bytes,
+                                         _cell_scatter_bytes };
+        unsigned long max_bytes[2];
+        MPI_Reduce( local_bytes, max_bytes, 2, MPI_UNSIGNED_LONG, MPI_MAX, 0,
+                    comm );
+        int rank;
+        MPI_Comm_rank( comm, &rank );
+        if ( 0 == rank )
+        {
+            printf( "Node scatter: %-10s (%.3f MB/rank)\n",
+                    _node_scatter_duplicated ? "duplicated" : "atomic",
+                    max_bytes[0] / 1.0e6 );
+            printf( "Cell scatter: %-10s (%.3f MB/rank)\n",
+                    _cell_scatter_duplicated ? "duplicated" : "atomic",
+                    max_bytes[1] / 1.0e6 );
+        }
+    }
+
     void scatter( Location::Node, Field::Momentum ) const
     {
+        Kokkos::Profiling::pushRegion(
+            "ProblemManager::scatter(Node,Momentum)" );
         _node_vector_halo->scatter( execution_space(),
                                     Cajita::ScatterReduce::Sum(), *_momentum );
+        Kokkos::Profiling::popRegion();
     }
 
     void scatter( Location::Node, Field::Mass ) const
     {
+        Kokkos::Profiling::pushRegion( "ProblemManager::scatter(Node,Mass)" );
         _node_scalar_halo->scatter( execution_space(),
                                     Cajita::ScatterReduce::Sum(), *_mass );
+        Kokkos::Profiling::popRegion();
     }
 
     void scatter( Location::Node, Field::Force ) const
     {
+        Kokkos::Profiling::pushRegion( "ProblemManager::scatter(Node,Force)" );
         _node_vector_halo->scatter( execution_space(),
                                     Cajita::ScatterReduce::Sum(), *_force );
+        Kokkos::Profiling::popRegion();
     }
 
     void scatter( Location::Node, Field::PositionCorrection ) const
     {
+        Kokkos::Profiling::pushRegion(
+            "ProblemManager::scatter(Node,PositionCorrection)" );
         _node_vector_halo->scatter( execution_space(),
                                     Cajita::ScatterReduce::Sum(),
                                     *_position_correction );
+        Kokkos::Profiling::popRegion();
     }
 
     void scatter( Location::Cell, Field::Density ) const
     {
+        Kokkos::Profiling::pushRegion(
+            "ProblemManager::scatter(Cell,Density)" );
         _cell_scalar_halo->scatter( execution_space(),
                                     Cajita::ScatterReduce::Sum(), *_density );
+        Kokkos::Profiling::popRegion();
     }
 
-    void scatter( Location::Cell, Field::Mark ) const
+    void scatter( Location::Cell, Field::Density, Field::Mark ) const
     {
-        _cell_scalar_halo->scatter( execution_space(),
-                                    Cajita::ScatterReduce::Sum(), *_mark );
+        Kokkos::Profiling::pushRegion(
+            "ProblemManager::scatter(Cell,Density,Mark)" );
+        _cell_grid_halo->scatter( execution_space(), *_density, *_mark );
+        Kokkos::Profiling::popRegion();
     }
 
     void gather( Location::Node, Field::Velocity ) const
     {
+        Kokkos::Profiling::pushRegion(
+            "ProblemManager::gather(Node,Velocity)" );
         _node_vector_halo->gather( execution_space(), *_velocity );
+        Kokkos::Profiling::popRegion();
     }
 
     void gather( Location::Node, Field::PositionCorrection ) const
     {
+        Kokkos::Profiling::pushRegion(
+            "ProblemManager::gather(Node,PositionCorrection)" );
         _node_vector_halo->gather( execution_space(), *_position_correction );
+        Kokkos::Profiling::popRegion();
+    }
+
+    void scatterGather( Location::Node, Field::PositionCorrection ) const
+    {
+        Kokkos::Profiling::pushRegion(
+            "ProblemManager::scatterGather(Node,PositionCorrection)" );
+        if ( _node_grid_halo->fusable() )
+        {
+            _node_grid_halo->scatterGather( execution_space(),
+                                            *_position_correction );
+        }
+        else
+        {
+            _node_vector_halo->scatter( execution_space(),
+                                        Cajita::ScatterReduce::Sum(),
+                                        *_position_correction );
+            _node_vector_halo->gather( execution_space(),
+                                       *_position_correction );
+        }
+        Kokkos::Profiling::popRegion();
+    }
+
+    void scatterGather( Location::Node, Field::Mass, Field::Momentum ) const
+    {
+        Kokkos::Profiling::pushRegion(
+            "ProblemManager::scatterGather(Node,Mass,Momentum)" );
+        if ( _node_grid_halo->fusable() )
+        {
+            _node_grid_halo->scatterGather( execution_space(), *_mass,
+                                            *_momentum );
+        }
+        else
+        {
+            _node_scalar_halo->scatter( execution_space(),
+                                        Cajita::ScatterReduce::Sum(), *_mass );
+            _node_vector_halo->scatter(
+                execution_space(), Cajita::ScatterReduce::Sum(), *_momentum );
+            _node_scalar_halo->gather( execution_space(), *_mass );
+            _node_vector_halo->gather( execution_space(), *_momentum );
+        }
+        Kokkos::Profiling::popRegion();
+    }
+
+    void scatterGather( Location::Node, Field::Mass, Field::Momentum,
+                        Field::Force ) const
+    {
+        Kokkos::Profiling::pushRegion(
+            "ProblemManager::scatterGather(Node,Mass,Momentum,Force)" );
+        if ( _node_grid_halo->fusable() )
+        {
+            _node_grid_halo->scatterGather(
+                execution_space(), *_mass, *_momentum, *_force );
+        }
+        else
+        {
+            _node_scalar_halo->scatter( execution_space(),
+                                        Cajita::ScatterReduce::Sum(), *_mass );
+            _node_vector_halo->scatter(
+                execution_space(), Cajita::ScatterReduce::Sum(), *_momentum );
+            _node_vector_halo->scatter( execution_space(),
+                                        Cajita::ScatterReduce::Sum(), *_force );
+            _node_scalar_halo->gather( execution_space(), *_mass );
+            _node_vector_halo->gather( execution_space(), *_momentum );
+            _node_vector_halo->gather( execution_space(), *_force );
+        }
+        Kokkos::Profiling::popRegion();
     }
 
     void communicateParticles( const int minimum_halo_width )
     {
-        auto positions = get( Location::Particle(), Field::Position() );
-        Cajita::particleGridMigrate( *( _mesh->localGrid() ), positions,
-                                     _particles, minimum_halo_width );
+        Kokkos::Profiling::pushRegion( "ProblemManager::communicateParticles" );
+        _particles.migrate( *( _mesh->localGrid() ), minimum_halo_width );
+        Kokkos::Profiling::popRegion();
+    }
+
+  private:
+    // Scatter views of a strategy.
+    template <class StrategyTag>
+    struct ScatterViews
+    {
+        node_scatter_view<StrategyTag> momentum;
+        node_scatter_view<StrategyTag> mass;
+        node_scatter_view<StrategyTag> force;
+        cell_scatter_view<StrategyTag> density;
+    };
+
+    const ScatterViews<Scatter::Atomic>& scatterViews( Scatter::Atomic ) const
+    {
+        return _atomic_scatter_views;
+    }
+
+    const ScatterViews<Scatter::Duplicated>&
+    scatterViews( Scatter::Duplicated ) const
+    {
+        return _duplicated_scatter_views;
+    }
+
+    template <class StrategyTag>
+    void createScatterViews( Location::Node,
+                             ScatterViews<StrategyTag>& views )
+    {
+        views.momentum = node_scatter_view<StrategyTag>( _momentum->view() );
+        views.mass = node_scatter_view<StrategyTag>( _mass->view() );
+        if ( TransferScheme::MLS != _options.transfer_scheme )
+            views.force = node_scatter_view<StrategyTag>( _force->view() );
+    }
+
+    template <class StrategyTag>
+    void createScatterViews( Location::Cell,
+                             ScatterViews<StrategyTag>& views )
+    {
+        views.density = cell_scatter_view<StrategyTag>( _density->view() );
     }
 
   private:
@@ -292,17 +589,27 @@ class ProblemManager
     double _rho;
     double _gamma;
     double _kappa;
-    particle_list _particles;
+    SolverOptions _options;
+    particle_storage _particles;
     std::shared_ptr<node_array> _momentum;
     std::shared_ptr<node_array> _mass;
     std::shared_ptr<node_array> _force;
     std::shared_ptr<node_array> _velocity;
     std::shared_ptr<node_array> _position_correction;
     std::shared_ptr<cell_array> _density;
-    std::shared_ptr<cell_array> _mark;
+    std::shared_ptr<mark_array> _mark;
     std::shared_ptr<halo> _node_vector_halo;
     std::shared_ptr<halo> _node_scalar_halo;
     std::shared_ptr<halo> _cell_scalar_halo;
+    std::shared_ptr<grid_halo> _node_grid_halo;
+    std::shared_ptr<grid_halo> _cell_grid_halo;
+    std::shared_ptr<Autotuner> _autotuner;
+    bool _node_scatter_duplicated;
+    bool _cell_scatter_duplicated;
+    std::size_t _node_scatter_bytes;
+    std::size_t _cell_scatter_bytes;
+    ScatterViews<Scatter::Atomic> _atomic_scatter_views;
+    ScatterViews<Scatter::Duplicated> _duplicated_scatter_views;
 };
 
 //---------------------------------------------------------------------------//
@@ -0,0 +1,173 @@
+/****************************************************************************
+ * Copyright (c) 2018-2020 by the ExaMPM authors                            *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the ExaMPM library. ExaMPM is distributed under a   *
+ * BSD 3-clause license. For the licensing terms see the LICENSE file in    *
+ * the top-level directory.                                                 *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#ifndef EXAMPM_SCATTERVIEW_HPP
+#define EXAMPM_SCATTERVIEW_HPP
+
+#include <ExaMPM_SolverOptions.hpp>
+
+#include <Kokkos_Core.hpp>
+#include <Kokkos_ScatterView.hpp>
+
+#include <mpi.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+
+namespace ExaMPM
+{
+//---------------------------------------------------------------------------//
+// Scatter view strategy tags.
+namespace Scatter
+{
+// All threads write a single shared copy of the array. The writes are atomic
+// unless the execution space runs a single thread.
+struct Atomic
+{
+};
+
+// Every thread writes its own copy of the array and the copies are summed
+// when the scatter is contributed. Only available on host execution spaces.
+struct Duplicated
+{
+};
+} // end namespace Scatter
+
+//---------------------------------------------------------------------------//
+// Scatter view type of a strategy. Devices always use the atomic strategy.
+template <class ViewType, class StrategyTag>
+struct ScatterViewType;
+
+template <class ViewType>
+struct ScatterViewType<ViewType, Scatter::Atomic>
+{
+    using type = Kokkos::Experimental::ScatterView<
+        typename ViewType::data_type, typename ViewType::array_layout,
+        typename ViewType::device_type, Kokkos::Experimental::ScatterSum,
+        Kokkos::Experimental::ScatterNonDuplicated>;
+};
+
+template <class ViewType>
+struct ScatterViewType<ViewType, Scatter::Duplicated>
+{
+    static constexpr bool host_accessible = Kokkos::SpaceAccessibility<
+        Kokkos::HostSpace, typename ViewType::memory_space>::accessible;
+
+    using type = Kokkos::Experimental::ScatterView<
+        typename ViewType::data_type, typename ViewType::array_layout,
+        typename ViewType::device_type, Kokkos::Experimental::ScatterSum,
+        typename std::conditional<
+            host_accessible, Kokkos::Experimental::ScatterDuplicated,
+            Kokkos::Experimental::ScatterNonDuplicated>::type>;
+};
+
+//---------------------------------------------------------------------------//
+// Time scattering stencil updates into a view with a given strategy. Each
+// update adds to a 3x3x3 block of entities at a pseudo-random location. The
+// view is zero on return.
+template <class StrategyTag, class ExecutionSpace, class ViewType>
+double timeScatterStrategy( const ExecutionSpace& exec_space,
+                            const ViewType& view, const int num_update )
+{
+    typename ScatterViewType<ViewType, StrategyTag>::type view_sv( view );
+
+    int extent[4] = { static_cast<int>( view.extent( 0 ) ),
+                      static_cast<int>( view.extent( 1 ) ),
+                      static_cast<int>( view.extent( 2 ) ),
+                      static_cast<int>( view.extent( 3 ) ) };
+
+    // Take the fastest of a few trials so the first touch of the copies is
+    // not counted.
+    double min_time = std::numeric_limits<double>::max();
+    for ( int t = 0; t < 3; ++t )
+    {
+        Kokkos::deep_copy( view, 0.0 );
+        exec_space.fence();
+        Kokkos::Timer timer;
+        view_sv.reset_except( view );
+        Kokkos::parallel_for(
+            "scatter_strategy_benchmark",
+            Kokkos::RangePolicy<ExecutionSpace>( exec_space, 0, num_update ),
+            KOKKOS_LAMBDA( const int n ) {
+                auto view_access = view_sv.access();
+                unsigned h = 2654435761u * static_cast<unsigned>( n + 1 );
+                int i = ( h >> 4 ) % ( extent[0] - 2 );
+                int j = ( h >> 12 ) % ( extent[1] - 2 );
+                int k = ( h >> 20 ) % ( extent[2] - 2 );
+                for ( int di = 0; di < 3; ++di )
+                    for ( int dj = 0; dj < 3; ++dj )
+                        for ( int dk = 0; dk < 3; ++dk )
+                            for ( int c = 0; c < extent[3]; ++c )
+                                view_access( i + di, j + dj, k + dk, c ) += 1.0;
+            } );
+        Kokkos::Experimental::contribute( view, view_sv );
+        exec_space.fence();
+        min_time = std::min( min_time, timer.seconds() );
+    }
+    Kokkos::deep_copy( view, 0.0 );
+
+    return min_time;
+}
+
+//---------------------------------------------------------------------------//
+// Select the scatter strategy for the arrays at one grid location. The view
+// is the largest array written at the location and is used to benchmark the
+// strategies. The duplicated footprint is the memory needed by the copies of
+// all arrays at the location. Returns true if the arrays should be
+// duplicated.
+template <class ExecutionSpace, class ViewType>
+bool selectScatterDuplication( const ExecutionSpace& exec_space,
+                               const ViewType& view,
+                               const std::size_t duplicated_footprint,
+                               const int num_update,
+                               const SolverOptions& options, MPI_Comm comm )
+{
+    // User selection.
+    if ( ScatterStrategy::ATOMIC == options.scatter_strategy )
+        return false;
+
+    // Duplication is only possible on the host.
+    if ( !ScatterViewType<ViewType, Scatter::Duplicated>::host_accessible )
+        return false;
+    if ( ScatterStrategy::DUPLICATED == options.scatter_strategy )
+        return true;
+
+    // A single thread writes the shared copy without atomics so there is
+    // nothing to gain from duplication.
+    if ( ExecutionSpace::concurrency() < 2 )
+        return false;
+
+    // Don't duplicate if the copies would take too much memory on any rank.
+    int local_fits =
+        ( duplicated_footprint <= options.scatter_duplication_max_bytes );
+    int global_fits;
+    MPI_Allreduce( &local_fits, &global_fits, 1, MPI_INT, MPI_MIN, comm );
+    if ( !global_fits )
+        return false;
+
+    // Time both strategies and use the one with the fastest slowest rank.
+    double local_time[2] = {
+        timeScatterStrategy<Scatter::Atomic>( exec_space, view,
+                                              std::max( num_update, 1 ) ),
+        timeScatterStrategy<Scatter::Duplicated>( exec_space, view,
+                                                  std::max( num_update, 1 ) ) };
+    double global_time[2];
+    MPI_Allreduce( local_time, global_time, 2, MPI_DOUBLE, MPI_MAX, comm );
+    return global_time[1] < global_time[0];
+}
+
+//---------------------------------------------------------------------------//
+
+} // end namespace ExaMPM
+
+#endif // EXAMPM_SCATTERVIEW_HPP
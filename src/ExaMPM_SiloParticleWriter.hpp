@@ -12,6 +12,8 @@
 #ifndef EXAMPM_SILOPARTICLEWRITER_HPP
 #define EXAMPM_SILOPARTICLEWRITER_HPP
 
+#include <ExaMPM_Types.hpp>
+
 #include <Cajita.hpp>
 
 #include <Cabana_Core.hpp>
@@ -78,9 +80,9 @@ void writeFieldsImpl(
         view( "field", slice.size() );
     Kokkos::parallel_for(
         "SiloParticleWriter::writeFieldRank0",
-        Kokkos::RangePolicy<typename SliceType::execution_space>(
+        ParticleRangePolicy<typename SliceType::execution_space>(
             0, slice.size() ),
-        KOKKOS_LAMBDA( const int i ) { view( i ) = slice( i ); } );
+        KOKKOS_LAMBDA( const ParticleIndex i ) { view( i ) = slice( i ); } );
 
     // Mirror the field to the host.
     auto host_view =
@@ -106,9 +108,9 @@ void writeFieldsImpl(
         view( "field", slice.size(), slice.extent( 2 ) );
     Kokkos::parallel_for(
         "SiloParticleWriter::writeFieldRank1",
-        Kokkos::RangePolicy<typename SliceType::execution_space>(
+        ParticleRangePolicy<typename SliceType::execution_space>(
             0, slice.size() ),
-        KOKKOS_LAMBDA( const int i ) {
+        KOKKOS_LAMBDA( const ParticleIndex i ) {
             for ( std::size_t d0 = 0; d0 < slice.extent( 2 ); ++d0 )
                 view( i, d0 ) = slice( i, d0 );
         } );
@@ -142,9 +144,9 @@ void writeFieldsImpl(
         view( "field", slice.size(), slice.extent( 2 ), slice.extent( 3 ) );
     Kokkos::parallel_for(
         "SiloParticleWriter::writeFieldRank2",
-        Kokkos::RangePolicy<typename SliceType::execution_space>(
+        ParticleRangePolicy<typename SliceType::execution_space>(
             0, slice.size() ),
-        KOKKOS_LAMBDA( const int i ) {
+        KOKKOS_LAMBDA( const ParticleIndex i ) {
             for ( std::size_t d0 = 0; d0 < slice.extent( 2 ); ++d0 )
                 for ( std::size_t d1 = 0; d1 < slice.extent( 3 ); ++d1 )
                     view( i, d0, d1 ) = slice( i, d0, d1 );
@@ -359,6 +361,8 @@ void writeTimeStep( const GlobalGridType& global_grid,
                     const int time_step_index, const double time,
                     const CoordSliceType& coords, FieldSliceTypes&&... fields )
 {
+    Kokkos::Profiling::pushRegion( "SiloParticleWriter::writeTimeStep" );
+
     // Pick a number of groups. We want to write approximately the N^3 blocks
     // to N^2 groups. Pick the block dimension with the largest number of
     // ranks as the number of groups. We may want to tweak this as an optional
@@ -403,9 +407,9 @@ void writeTimeStep( const GlobalGridType& global_grid,
         view( "coords", coords.size(), coords.extent( 2 ) );
     Kokkos::parallel_for(
         "SiloParticleWriter::writeCoords",
-        Kokkos::RangePolicy<typename CoordSliceType::execution_space>(
+        ParticleRangePolicy<typename CoordSliceType::execution_space>(
             0, coords.size() ),
-        KOKKOS_LAMBDA( const int i ) {
+        KOKKOS_LAMBDA( const ParticleIndex i ) {
             for ( std::size_t d0 = 0; d0 < coords.extent( 2 ); ++d0 )
                 view( i, d0 ) = coords( i, d0 );
         } );
@@ -439,6 +443,8 @@ void writeTimeStep( const GlobalGridType& global_grid,
 
     // Finish.
     PMPIO_Finish( baton );
+
+    Kokkos::Profiling::popRegion();
 }
 
 //---------------------------------------------------------------------------//
@@ -13,10 +13,13 @@
 #define EXAMPM_SOLVER_HPP
 
 #include <ExaMPM_BoundaryConditions.hpp>
+#include <ExaMPM_Diagnostics.hpp>
 #include <ExaMPM_Mesh.hpp>
 #include <ExaMPM_ProblemManager.hpp>
 #include <ExaMPM_SiloParticleWriter.hpp>
+#include <ExaMPM_SolverOptions.hpp>
 #include <ExaMPM_TimeIntegrator.hpp>
+#include <ExaMPM_Timer.hpp>
 
 #include <Kokkos_Core.hpp>
 
@@ -32,14 +35,24 @@ class SolverBase
 {
   public:
     virtual ~SolverBase() = default;
-    virtual void solve( const double t_final, const int write_freq ) = 0;
+    virtual void solve( const double t_final, const int write_freq,
+                        const int diagnostic_freq ) = 0;
+    virtual Timer& timer() = 0;
+    virtual const Timer& timer() const = 0;
 };
 
 //---------------------------------------------------------------------------//
-template <class MemorySpace, class ExecutionSpace>
+template <class MemorySpace, class ExecutionSpace,
+          class BoundaryPolicyType = RuntimeBoundaryPolicy,
+          bool UniformMass = false, bool SplitPosition = false,
+          bool PackedPosition = false>
 class Solver : public SolverBase
 {
   public:
+    using problem_manager =
+        ProblemManager<MemorySpace, DefaultVectorLength<MemorySpace>::value,
+                       SplitPosition, UniformMass, PackedPosition>;
+
     template <class InitFunc>
     Solver( MPI_Comm comm, const Kokkos::Array<double, 6>& global_bounding_box,
             const std::array<int, 3>& global_num_cell,
@@ -49,7 +62,8 @@ class Solver : public SolverBase
             const int particles_per_cell, const double bulk_modulus,
             const double density, const double gamma, const double kappa,
             const double delta_t, const double gravity,
-            const BoundaryCondition& bc )
+            const BoundaryCondition& bc,
+            const SolverOptions& options = SolverOptions() )
         : _dt( delta_t )
         , _gravity( gravity )
         , _bc( bc )
@@ -62,35 +76,87 @@ class Solver : public SolverBase
         _bc.min = _mesh->minDomainGlobalNodeIndex();
         _bc.max = _mesh->maxDomainGlobalNodeIndex();
 
-        _pm = std::make_shared<ProblemManager<MemorySpace>>(
+        _pm = std::make_shared<problem_manager>(
             ExecutionSpace(), _mesh, create_functor, particles_per_cell,
-            bulk_modulus, density, gamma, kappa );
+            bulk_modulus, density, gamma, kappa, options );
+        _pm->reportScatterStrategy();
+
+        // Only the nodes on the domain boundary are affected by the boundary
+        // condition so build the list of them once.
+        _bc_nodes = BoundaryNodeList<MemorySpace, BoundaryPolicyType>(
+            ExecutionSpace(), _bc, *( _mesh->localGrid() ) );
 
         MPI_Comm_rank( comm, &_rank );
+        if ( 0 == _rank && options.autotune_kernels &&
+             options.numa_first_touch )
+            printf( "Warning: autotune_kernels is ignored with "
+                    "numa_first_touch\n" );
     }
 
-    void solve( const double t_final, const int write_freq ) override
+    void solve( const double t_final, const int write_freq,
+                const int diagnostic_freq ) override
     {
-        SiloParticleWriter::writeTimeStep(
-            _mesh->localGrid()->globalGrid(), 0, 0.0,
-            _pm->get( Location::Particle(), Field::Position() ),
-            _pm->get( Location::Particle(), Field::Velocity() ),
-            _pm->get( Location::Particle(), Field::J() ) );
+        _timer.reset();
+        auto comm = _mesh->localGrid()->globalGrid().comm();
+        const std::string& diagnostic_file = _pm->options().diagnostic_file;
+
+        // Particle output and diagnostics are disabled with a non-positive
+        // frequency.
+        _timer.start( Phase::OUTPUT );
+        if ( write_freq > 0 )
+            SiloParticleWriter::writeTimeStep(
+                _mesh->localGrid()->globalGrid(), 0, 0.0,
+                _pm->get( Location::Particle(), Field::Position() ),
+                _pm->get( Location::Particle(), Field::Velocity() ),
+                _pm->get( Location::Particle(), Field::J() ) );
+
+        if ( diagnostic_freq > 0 )
+        {
+            Diagnostics::writeHeader( comm, diagnostic_file );
+            Diagnostics::write(
+                comm, diagnostic_file, 0, 0.0,
+                Diagnostics::compute( ExecutionSpace(), *_pm, _gravity,
+                                      comm ) );
+        }
+        _timer.stop( Phase::OUTPUT );
 
         int num_step = t_final / _dt;
         double delta_t = t_final / num_step;
         double time = 0.0;
+        double last_print_time = 0.0;
+        int last_print_step = 0;
         for ( int t = 0; t < num_step; ++t )
         {
-            if ( 0 == _rank && 0 == t % write_freq )
-                printf( "Step %d / %d\n", t + 1, num_step );
+            if ( 0 == _rank && write_freq > 0 && 0 == t % write_freq )
+            {
+                // Report the average time per step since the last report.
+                double total = _timer.seconds( Phase::TOTAL );
+                double step_time =
+                    ( t > last_print_step )
+                        ? ( total - last_print_time ) / ( t - last_print_step )
+                        : 0.0;
+                printf( "Step %d / %d (%.4e s/step)\n", t + 1, num_step,
+                        step_time );
+                last_print_time = total;
+                last_print_step = t;
+            }
+
+            _timer.start( Phase::TOTAL );
+
+            _timer.addParticleUpdates( _pm->numParticle() );
 
             TimeIntegrator::step( ExecutionSpace(), *_pm, delta_t, _gravity,
-                                  _bc );
+                                  _bc_nodes, _timer );
 
+            _timer.start( Phase::PARTICLE_MIGRATION );
             _pm->communicateParticles( _halo_min );
+            _timer.stop( Phase::PARTICLE_MIGRATION );
 
-            if ( 0 == t % write_freq )
+            // Save the tuned launch parameters once tuning is complete.
+            _pm->autotuner().finish();
+
+            _timer.start( Phase::OUTPUT );
+            if ( write_freq > 0 && 0 == t % write_freq )
                 SiloParticleWriter::writeTimeStep(
                     _mesh->localGrid()->globalGrid(), t + 1, time,
                     _pm->get( Location::Particle(), Field::Position() ),
@@ -98,22 +164,137 @@ class Solver : public SolverBase
                     _pm->get( Location::Particle(), Field::J() ) );
 
             time += delta_t;
+
+            if ( diagnostic_freq > 0 && 0 == ( t + 1 ) % diagnostic_freq )
+                Diagnostics::write(
+                    comm, diagnostic_file, t + 1, time,
+                    Diagnostics::compute( ExecutionSpace(), *_pm, _gravity,
+                                          comm ) );
+            _timer.stop( Phase::OUTPUT );
+
+            _timer.stop( Phase::TOTAL );
         }
+
+        // Performance report.
+        _timer.report( comm );
     }
 
+    Timer& timer() override { return _timer; }
+
+    const Timer& timer() const override { return _timer; }
+
   private:
     double _dt;
     double _gravity;
     BoundaryCondition _bc;
+    BoundaryNodeList<MemorySpace, BoundaryPolicyType> _bc_nodes;
     int _halo_min;
     std::shared_ptr<Mesh<MemorySpace>> _mesh;
-    std::shared_ptr<ProblemManager<MemorySpace>> _pm;
+    std::shared_ptr<problem_manager> _pm;
     int _rank;
+    Timer _timer;
 };
 
 //---------------------------------------------------------------------------//
-// Creation method.
-template <class InitFunc>
+// Create a solver in a given memory and execution space with the boundary
+// policy named by the caller. A compile-time policy must match the boundary
+// condition.
+template <class MemorySpace, class ExecutionSpace, class BoundaryPolicyType,
+          bool UniformMass, bool SplitPosition, bool PackedPosition,
+          class InitFunc>
+std::shared_ptr<SolverBase> createSolverWithBoundary(
+    MPI_Comm comm, const Kokkos::Array<double, 6>& global_bounding_box,
+    const std::array<int, 3>& global_num_cell,
+    const std::array<bool, 3>& periodic,
+    const Cajita::BlockPartitioner<3>& partitioner, const int halo_cell_width,
+    const InitFunc& create_functor, const int particles_per_cell,
+    const double bulk_modulus, const double density, const double gamma,
+    const double kappa, const double delta_t, const double gravity,
+    const BoundaryCondition& bc, const SolverOptions& options )
+{
+    if ( !BoundaryPolicyType::matches( bc ) )
+        throw std::runtime_error(
+            "Boundary condition does not match the boundary policy" );
+
+    return std::make_shared<
+        ExaMPM::Solver<MemorySpace, ExecutionSpace, BoundaryPolicyType,
+                       UniformMass, SplitPosition, PackedPosition>>(
+        comm, global_bounding_box, global_num_cell, periodic, partitioner,
+        halo_cell_width, create_functor, particles_per_cell, bulk_modulus,
+        density, gamma, kappa, delta_t, gravity, bc, options );
+}
+
+//---------------------------------------------------------------------------//
+// Create a solver with the particle mass storage selected by the options.
+template <class MemorySpace, class ExecutionSpace, class BoundaryPolicyType,
+          bool SplitPosition, bool PackedPosition, class InitFunc>
+std::shared_ptr<SolverBase> createSolverWithMass(
+    MPI_Comm comm, const Kokkos::Array<double, 6>& global_bounding_box,
+    const std::array<int, 3>& global_num_cell,
+    const std::array<bool, 3>& periodic,
+    const Cajita::BlockPartitioner<3>& partitioner, const int halo_cell_width,
+    const InitFunc& create_functor, const int particles_per_cell,
+    const double bulk_modulus, const double density, const double gamma,
+    const double kappa, const double delta_t, const double gravity,
+    const BoundaryCondition& bc, const SolverOptions& options )
+{
+    if ( options.uniform_particle_mass )
+        return createSolverWithBoundary<MemorySpace, ExecutionSpace,
+                                        BoundaryPolicyType, true,
+                                        SplitPosition, PackedPosition>(
+            comm, global_bounding_box, global_num_cell, periodic, partitioner,
+            halo_cell_width, create_functor, particles_per_cell, bulk_modulus,
+            density, gamma, kappa, delta_t, gravity, bc, options );
+    else
+        return createSolverWithBoundary<MemorySpace, ExecutionSpace,
+                                        BoundaryPolicyType, false,
+                                        SplitPosition, PackedPosition>(
+            comm, global_bounding_box, global_num_cell, periodic, partitioner,
+            halo_cell_width, create_functor, particles_per_cell, bulk_modulus,
+            density, gamma, kappa, delta_t, gravity, bc, options );
+}
+
+//---------------------------------------------------------------------------//
+// Create a solver with the particle storage selected by the options. Packed
+// positions are always stored split from the other members.
+template <class MemorySpace, class ExecutionSpace, class BoundaryPolicyType,
+          class InitFunc>
+std::shared_ptr<SolverBase> createSolverWithStorage(
+    MPI_Comm comm, const Kokkos::Array<double, 6>& global_bounding_box,
+    const std::array<int, 3>& global_num_cell,
+    const std::array<bool, 3>& periodic,
+    const Cajita::BlockPartitioner<3>& partitioner, const int halo_cell_width,
+    const InitFunc& create_functor, const int particles_per_cell,
+    const double bulk_modulus, const double density, const double gamma,
+    const double kappa, const double delta_t, const double gravity,
+    const BoundaryCondition& bc, const SolverOptions& options )
+{
+    if ( options.packed_particle_position )
+        return createSolverWithMass<MemorySpace, ExecutionSpace,
+                                    BoundaryPolicyType, true, true>(
+            comm, global_bounding_box, global_num_cell, periodic, partitioner,
+            halo_cell_width, create_functor, particles_per_cell, bulk_modulus,
+            density, gamma, kappa, delta_t, gravity, bc, options );
+    else if ( options.split_particle_position )
+        return createSolverWithMass<MemorySpace, ExecutionSpace,
+                                    BoundaryPolicyType, true, false>(
+            comm, global_bounding_box, global_num_cell, periodic, partitioner,
+            halo_cell_width, create_functor, particles_per_cell, bulk_modulus,
+            density, gamma, kappa, delta_t, gravity, bc, options );
+    else
+        return createSolverWithMass<MemorySpace, ExecutionSpace,
+                                    BoundaryPolicyType, false, false>(
+            comm, global_bounding_box, global_num_cell, periodic, partitioner,
+            halo_cell_width, create_functor, particles_per_cell, bulk_modulus,
+            density, gamma, kappa, delta_t, gravity, bc, options );
+}
+
+//---------------------------------------------------------------------------//
+// Creation method. The boundary policy is named at the call site, e.g.
+// createSolver<FreeSlipPolicy>( ... ), so only the solvers of that policy are
+// instantiated. Mixed faces are named as BoundaryPolicy<Faces...>. The
+// default RuntimeBoundaryPolicy accepts any boundary condition.
+template <class BoundaryPolicyType = RuntimeBoundaryPolicy, class InitFunc>
 std::shared_ptr<SolverBase>
 createSolver( const std::string& device, MPI_Comm comm,
               const Kokkos::Array<double, 6>& global_bounding_box,
@@ -124,16 +305,17 @@ createSolver( const std::string& device, MPI_Comm comm,
               const int particles_per_cell, const double bulk_modulus,
               const double density, const double gamma, const double kappa,
               const double delta_t, const double gravity,
-              const BoundaryCondition& bc )
+              const BoundaryCondition& bc,
+              const SolverOptions& options = SolverOptions() )
 {
     if ( 0 == device.compare( "serial" ) )
     {
 #ifdef KOKKOS_ENABLE_SERIAL
-        return std::make_shared<
-            ExaMPM::Solver<Kokkos::HostSpace, Kokkos::Serial>>(
+        return createSolverWithStorage<Kokkos::HostSpace, Kokkos::Serial,
+                                       BoundaryPolicyType>(
             comm, global_bounding_box, global_num_cell, periodic, partitioner,
             halo_cell_width, create_functor, particles_per_cell, bulk_modulus,
-            density, gamma, kappa, delta_t, gravity, bc );
+            density, gamma, kappa, delta_t, gravity, bc, options );
 #else
         throw std::runtime_error( "Serial Backend Not Enabled" );
 #endif
@@ -141,11 +323,11 @@ createSolver( const std::string& device, MPI_Comm comm,
     else if ( 0 == device.compare( "openmp" ) )
     {
 #ifdef KOKKOS_ENABLE_OPENMP
-        return std::make_shared<
-            ExaMPM::Solver<Kokkos::HostSpace, Kokkos::OpenMP>>(
+        return createSolverWithStorage<Kokkos::HostSpace, Kokkos::OpenMP,
+                                       BoundaryPolicyType>(
             comm, global_bounding_box, global_num_cell, periodic, partitioner,
             halo_cell_width, create_functor, particles_per_cell, bulk_modulus,
-            density, gamma, kappa, delta_t, gravity, bc );
+            density, gamma, kappa, delta_t, gravity, bc, options );
 #else
         throw std::runtime_error( "OpenMP Backend Not Enabled" );
 #endif
@@ -153,11 +335,11 @@ createSolver( const std::string& device, MPI_Comm comm,
     else if ( 0 == device.compare( "cuda" ) )
     {
 #ifdef KOKKOS_ENABLE_CUDA
-        return std::make_shared<
-            ExaMPM::Solver<Kokkos::CudaSpace, Kokkos::Cuda>>(
+        return createSolverWithStorage<Kokkos::CudaSpace, Kokkos::Cuda,
+                                       BoundaryPolicyType>(
             comm, global_bounding_box, global_num_cell, periodic, partitioner,
             halo_cell_width, create_functor, particles_per_cell, bulk_modulus,
-            density, gamma, kappa, delta_t, gravity, bc );
+            density, gamma, kappa, delta_t, gravity, bc, options );
 #else
         throw std::runtime_error( "CUDA Backend Not Enabled" );
 #endif
@@ -165,11 +347,12 @@ createSolver( const std::string& device, MPI_Comm comm,
     else if ( 0 == device.compare( "hip" ) )
     {
 #ifdef KOKKOS_ENABLE_HIP
-        return std::make_shared<ExaMPM::Solver<Kokkos::Experimental::HIPSpace,
-                                               Kokkos::Experimental::HIP>>(
+        return createSolverWithStorage<Kokkos::Experimental::HIPSpace,
+                                       Kokkos::Experimental::HIP,
+                                       BoundaryPolicyType>(
             comm, global_bounding_box, global_num_cell, periodic, partitioner,
             halo_cell_width, create_functor, particles_per_cell, bulk_modulus,
-            density, gamma, kappa, delta_t, gravity, bc );
+            density, gamma, kappa, delta_t, gravity, bc, options );
 #else
         throw std::runtime_error( "HIP Backend Not Enabled" );
 #endif
@@ -0,0 +1,120 @@
+/****************************************************************************
+ * Copyright (c) 2018-2020 by the ExaMPM authors                            *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the ExaMPM library. ExaMPM is distributed under a   *
+ * BSD 3-clause license. For the licensing terms see the LICENSE file in    *
+ * the top-level directory.                                                 *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#ifndef EXAMPM_SOLVEROPTIONS_HPP
+#define EXAMPM_SOLVEROPTIONS_HPP
+
+#include <cstddef>
+#include <string>
+
+namespace ExaMPM
+{
+//---------------------------------------------------------------------------//
+// Strategy used by the scatter views of the grid transfers.
+struct ScatterStrategy
+{
+    enum Values
+    {
+        // Select from the backend, grid size, and a startup benchmark.
+        AUTO = 0,
+        // A single shared copy updated with atomics.
+        ATOMIC = 1,
+        // A copy per thread. Falls back to atomic on devices.
+        DUPLICATED = 2
+    };
+};
+
+//---------------------------------------------------------------------------//
+// Particle-to-grid transfer scheme.
+struct TransferScheme
+{
+    enum Values
+    {
+        // APIC momentum transfer with a separate pressure force projection.
+        APIC = 0,
+        // MLS-MPM transfer. The pressure impulse is folded into the affine
+        // momentum so the grid momentum includes the force update.
+        MLS = 1
+    };
+};
+
+//---------------------------------------------------------------------------//
+// Optional solver behavior. The defaults reproduce the reference algorithm.
+struct SolverOptions
+{
+    // File the global diagnostics are written to when they are enabled.
+    std::string diagnostic_file = "diagnostics.csv";
+
+    // Complete the grid transfer fields on the ghost nodes after p2g and
+    // compute the velocity redundantly on the ghosts. This replaces the
+    // separate velocity gather before g2p with a single fused exchange of
+    // the mass, momentum, and force.
+    bool redundant_ghost_solve = false;
+
+    // Scatter view strategy of the grid transfers.
+    int scatter_strategy = ScatterStrategy::AUTO;
+
+    // The automatic strategy never duplicates the arrays of a grid location
+    // if the copies would need more than this many bytes on a rank.
+    std::size_t scatter_duplication_max_bytes = std::size_t( 1 ) << 30;
+
+    // Share node array storage between fields with disjoint lifetimes. The
+    // velocity overwrites the momentum in the field solve and the position
+    // correction reuses the force. This cuts the node array storage from 13
+    // to 7 values per node.
+    bool alias_node_arrays = false;
+
+    // Particle-to-grid transfer scheme.
+    int transfer_scheme = TransferScheme::APIC;
+
+    // Store a single mass and volume for all particles instead of one per
+    // particle. Every particle must be created with the same mass and
+    // volume. The solver factory selects the uniform particle storage at
+    // compile time from this flag.
+    bool uniform_particle_mass = false;
+
+    // Store the particle positions in a separate AoSoA from the other
+    // particle members so the position-only kernels stream less data.
+    bool split_particle_position = false;
+
+    // Store the particle positions in the 12-byte cell-relative fixed-point
+    // format. Implies split particle positions. The rank-local grid block,
+    // padded by one cell, may use at most 32 bits of cell index.
+    bool packed_particle_position = false;
+
+    // Allocate the particles and grid arrays without initialization and
+    // write them first with the policies of the compute kernels. On
+    // multi-socket hosts this places each thread's data on its own NUMA node
+    // with the OpenMP first-touch page policy. The particles are touched
+    // again after every migration that moves them. Kernel autotuning is
+    // disabled with this option so the kernels keep the placement policies.
+    bool numa_first_touch = false;
+
+    // Time the candidate MDRange tile shapes of the grid kernels and the
+    // chunk sizes of the boundary and particle loops over the first steps
+    // and use the fastest of each. Ignored with numa_first_touch: the pages
+    // are placed for the default policies and a tuned policy would run most
+    // iterations on threads of another socket.
+    bool autotune_kernels = false;
+
+    // Number of timed launches of each candidate. The fastest is kept.
+    int autotune_trials = 2;
+
+    // File the tuned choices are read from and saved to, keyed by host,
+    // kernel, and local grid extent. An empty name disables the cache.
+    std::string autotune_cache_file = "exampm_autotune.txt";
+};
+
+//---------------------------------------------------------------------------//
+
+} // end namespace ExaMPM
+
+#endif // EXAMPM_SOLVEROPTIONS_HPP
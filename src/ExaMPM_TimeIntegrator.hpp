@@ -12,8 +12,12 @@
 #ifndef EXAMPM_TIMEINTEGRATOR_HPP
 #define EXAMPM_TIMEINTEGRATOR_HPP
 
+#include <ExaMPM_Autotune.hpp>
 #include <ExaMPM_BoundaryConditions.hpp>
 #include <ExaMPM_ProblemManager.hpp>
+#include <ExaMPM_ScatterView.hpp>
+#include <ExaMPM_SolverOptions.hpp>
+#include <ExaMPM_Timer.hpp>
 #include <ExaMPM_VelocityInterpolation.hpp>
 
 #include <Cajita.hpp>
@@ -27,9 +31,10 @@ namespace ExaMPM
 namespace TimeIntegrator
 {
 //---------------------------------------------------------------------------//
-// Particle-to-grid.
-template <class ProblemManagerType, class ExecutionSpace>
-void p2g( const ExecutionSpace& exec_space, const ProblemManagerType& pm )
+// Particle-to-grid with a given scatter strategy.
+template <class ProblemManagerType, class ExecutionSpace, class StrategyTag>
+void p2g( const ExecutionSpace& exec_space, const ProblemManagerType& pm,
+          const double delta_t, Timer& timer, StrategyTag strategy )
 {
     // Get the particle data we need.
     auto m_p = pm.get( Location::Particle(), Field::Mass() );
@@ -44,15 +49,24 @@ void p2g( const ExecutionSpace& exec_space, const ProblemManagerType& pm )
     auto mu_i = pm.get( Location::Node(), Field::Momentum() );
     auto f_i = pm.get( Location::Node(), Field::Force() );
 
+    // With an MLS transfer the force is included in the momentum, the force
+    // stays zero, and it has no scatter view.
+    bool mls = ( TransferScheme::MLS == pm.options().transfer_scheme );
+
     // Reset write views.
     Kokkos::deep_copy( m_i, 0.0 );
     Kokkos::deep_copy( mu_i, 0.0 );
     Kokkos::deep_copy( f_i, 0.0 );
 
-    // Create the scatter views we need.
-    auto m_i_sv = Kokkos::Experimental::create_scatter_view( m_i );
-    auto mu_i_sv = Kokkos::Experimental::create_scatter_view( mu_i );
-    auto f_i_sv = Kokkos::Experimental::create_scatter_view( f_i );
+    // Reset the scatter views we need.
+    auto m_i_sv = pm.getScatter( Location::Node(), Field::Mass(), strategy );
+    auto mu_i_sv =
+        pm.getScatter( Location::Node(), Field::Momentum(), strategy );
+    auto f_i_sv = pm.getScatter( Location::Node(), Field::Force(), strategy );
+    m_i_sv.reset_except( m_i );
+    mu_i_sv.reset_except( mu_i );
+    if ( !mls )
+        f_i_sv.reset_except( f_i );
 
     // Get the fluid properties.
     double bulk_mod = pm.bulkModulus();
@@ -63,59 +77,147 @@ void p2g( const ExecutionSpace& exec_space, const ProblemManagerType& pm )
         Cajita::createLocalMesh<ExecutionSpace>( *( pm.mesh()->localGrid() ) );
 
     // Loop over particles.
-    Kokkos::parallel_for(
-        "p2g",
-        Kokkos::RangePolicy<ExecutionSpace>( exec_space, 0, pm.numParticle() ),
-        KOKKOS_LAMBDA( const int p ) {
-            // Get the particle position.
-            double x[3] = { x_p( p, 0 ), x_p( p, 1 ), x_p( p, 2 ) };
-
-            // Setup interpolation to the nodes.
-            Cajita::SplineData<double, 2, 3, Cajita::Node> sd;
-            Cajita::evaluateSpline( local_mesh, x, sd );
-
-            // Compute the pressure on the particle with an equation of
-            // state.
-            double pressure = -bulk_mod * ( pow( j_p( p ), -gamma ) - 1.0 );
-
-            // Project the pressure gradient to the grid.
-            Cajita::P2G::gradient( -v_p( p ) * j_p( p ) * pressure, sd,
-                                   f_i_sv );
-
-            // Extract the particle velocity
-            double vel_p[3] = { u_p( p, 0 ), u_p( p, 1 ), u_p( p, 2 ) };
-
-            // Extract the affine particle matrix.
-            double aff_p[3][3];
-            for ( int d0 = 0; d0 < 3; ++d0 )
-                for ( int d1 = 0; d1 < 3; ++d1 )
-                    aff_p[d0][d1] = B_p( p, d0, d1 );
-
-            // Project momentum to the grid.
-            APIC::p2g( m_p( p ), vel_p, aff_p, sd, mu_i_sv );
-
-            // Project mass to the grid.
-            Cajita::P2G::value( m_p( p ), sd, m_i_sv );
-        } );
+    timer.start( Phase::P2G );
+    auto& tuner = pm.autotuner();
+    auto policy =
+        ParticleRangePolicy<ExecutionSpace>( exec_space, 0, pm.numParticle() );
+    if ( mls )
+    {
+        int chunk = tuner.start( exec_space, "p2g_mls", pm.numParticle(),
+                                 Autotuner::num_chunk );
+        Kokkos::parallel_for(
+            "p2g_mls", setTunedChunkSize( policy, chunk ),
+            KOKKOS_LAMBDA( const ParticleIndex p ) {
+                // Get the particle position.
+                double x[3] = { x_p( p, 0 ), x_p( p, 1 ), x_p( p, 2 ) };
+
+                // Setup interpolation to the nodes.
+                Cajita::SplineData<double, 2, 3, Cajita::Node> sd;
+                Cajita::evaluateSpline( local_mesh, x, sd );
+
+                // Compute the pressure on the particle with an equation of
+                // state.
+                double pressure =
+                    -bulk_mod * ( pow( j_p( p ), -gamma ) - 1.0 );
+
+                // Extract the particle velocity
+                double vel_p[3] = { u_p( p, 0 ), u_p( p, 1 ), u_p( p, 2 ) };
+
+                // Combine the affine momentum and the pressure impulse in
+                // one matrix. The pressure gradient projection is
+                // approximated by the weights times the inverse inertial
+                // tensor applied to the node distance.
+                double D_p_inv = APIC::inertialScaling( sd );
+                double impulse = -delta_t * v_p( p ) * j_p( p ) * pressure;
+                double C_p[3][3];
+                for ( int d0 = 0; d0 < 3; ++d0 )
+                {
+                    for ( int d1 = 0; d1 < 3; ++d1 )
+                        C_p[d0][d1] = D_p_inv * m_p( p ) * B_p( p, d0, d1 );
+                    C_p[d0][d0] += D_p_inv * impulse;
+                }
+
+                // Project momentum to the grid.
+                MLS::p2g( m_p( p ), vel_p, C_p, sd, mu_i_sv );
+
+                // Project mass to the grid.
+                Cajita::P2G::value( m_p( p ), sd, m_i_sv );
+            } );
+    }
+    else
+    {
+        int chunk = tuner.start( exec_space, "p2g", pm.numParticle(),
+                                 Autotuner::num_chunk );
+        Kokkos::parallel_for(
+            "p2g", setTunedChunkSize( policy, chunk ),
+            KOKKOS_LAMBDA( const ParticleIndex p ) {
+                // Get the particle position.
+                double x[3] = { x_p( p, 0 ), x_p( p, 1 ), x_p( p, 2 ) };
+
+                // Setup interpolation to the nodes.
+                Cajita::SplineData<double, 2, 3, Cajita::Node> sd;
+                Cajita::evaluateSpline( local_mesh, x, sd );
+
+                // Compute the pressure on the particle with an equation of
+                // state.
+                double pressure = -bulk_mod * ( pow( j_p( p ), -gamma ) - 1.0 );
+
+                // Project the pressure gradient to the grid.
+                Cajita::P2G::gradient( -v_p( p ) * j_p( p ) * pressure, sd,
+                                       f_i_sv );
+
+                // Extract the particle velocity
+                double vel_p[3] = { u_p( p, 0 ), u_p( p, 1 ), u_p( p, 2 ) };
+
+                // Extract the affine particle matrix.
+                double aff_p[3][3];
+                for ( int d0 = 0; d0 < 3; ++d0 )
+                    for ( int d1 = 0; d1 < 3; ++d1 )
+                        aff_p[d0][d1] = B_p( p, d0, d1 );
+
+                // Project momentum to the grid.
+                APIC::p2g( m_p( p ), vel_p, aff_p, sd, mu_i_sv );
+
+                // Project mass to the grid.
+                Cajita::P2G::value( m_p( p ), sd, m_i_sv );
+            } );
+    }
+    tuner.stop( exec_space );
+    timer.stop( Phase::P2G );
 
     // Complete local scatter.
+    timer.start( Phase::P2G_CONTRIBUTE );
     Kokkos::Experimental::contribute( m_i, m_i_sv );
     Kokkos::Experimental::contribute( mu_i, mu_i_sv );
-    Kokkos::Experimental::contribute( f_i, f_i_sv );
+    if ( !mls )
+        Kokkos::Experimental::contribute( f_i, f_i_sv );
+    timer.stop( Phase::P2G_CONTRIBUTE );
+
+    // Complete global scatter. With a redundant ghost solve the ghost nodes
+    // also receive the complete values so the field solve can compute valid
+    // ghost velocities without a later gather.
+    timer.start( Phase::HALO_SCATTER );
+    if ( pm.options().redundant_ghost_solve )
+    {
+        if ( mls )
+            pm.scatterGather( Location::Node(), Field::Mass(),
+                              Field::Momentum() );
+        else
+            pm.scatterGather( Location::Node(), Field::Mass(),
+                              Field::Momentum(), Field::Force() );
+    }
+    else
+    {
+        pm.scatter( Location::Node(), Field::Mass() );
+        pm.scatter( Location::Node(), Field::Momentum() );
+        if ( !mls )
+            pm.scatter( Location::Node(), Field::Force() );
+    }
+    timer.stop( Phase::HALO_SCATTER );
+}
 
-    // Complete global scatter.
-    pm.scatter( Location::Node(), Field::Mass() );
-    pm.scatter( Location::Node(), Field::Momentum() );
-    pm.scatter( Location::Node(), Field::Force() );
+//---------------------------------------------------------------------------//
+// Particle-to-grid.
+template <class ProblemManagerType, class ExecutionSpace>
+void p2g( const ExecutionSpace& exec_space, const ProblemManagerType& pm,
+          const double delta_t, Timer& timer )
+{
+    if ( pm.scatterDuplicated( Location::Node() ) )
+        p2g( exec_space, pm, delta_t, timer, Scatter::Duplicated() );
+    else
+        p2g( exec_space, pm, delta_t, timer, Scatter::Atomic() );
 }
 
 //---------------------------------------------------------------------------//
 // Field solve.
-template <class ProblemManagerType, class ExecutionSpace>
+template <class ProblemManagerType, class ExecutionSpace,
+          class BoundaryNodeListType>
 void fieldSolve( const ExecutionSpace& exec_space, const ProblemManagerType& pm,
                  const double delta_t, const double gravity,
-                 const BoundaryCondition& bc )
+                 const BoundaryNodeListType& bc_nodes, Timer& timer )
 {
+    timer.start( Phase::FIELD_SOLVE );
+
     // Get the views we need.
     auto m_i = pm.get( Location::Node(), Field::Mass() );
     auto mu_i = pm.get( Location::Node(), Field::Momentum() );
@@ -128,17 +230,16 @@ void fieldSolve( const ExecutionSpace& exec_space, const ProblemManagerType& pm,
     // Node mass epsilon. Masses smaller than this will be ignored.
     double mass_epsilon = 1.0e-12;
 
-    // Compute the velocity.
-    auto l2g = Cajita::IndexConversion::createL2G( *( pm.mesh()->localGrid() ),
-                                                   Cajita::Node() );
+    // Compute the velocity. Each component only reads the momentum and force
+    // of the same component so the velocity may alias the momentum.
     auto local_nodes = pm.mesh()->localGrid()->indexSpace(
         Cajita::Ghost(), Cajita::Node(), Cajita::Local() );
+    auto& tuner = pm.autotuner();
+    int tile = tuner.start( exec_space, "field_solve", local_nodes,
+                            Autotuner::num_tile );
     Kokkos::parallel_for(
-        Cajita::createExecutionPolicy( local_nodes, exec_space ),
+        "field_solve", createTunedPolicy( local_nodes, exec_space, tile ),
         KOKKOS_LAMBDA( const int li, const int lj, const int lk ) {
-            int gi, gj, gk;
-            l2g( li, lj, lk, gi, gj, gk );
-
             // Only compute velocity if a node has mass
             u_i( li, lj, lk, 0 ) = ( m_i( li, lj, lk, 0 ) > mass_epsilon )
                                        ? ( mu_i( li, lj, lk, 0 ) +
@@ -156,18 +257,24 @@ void fieldSolve( const ExecutionSpace& exec_space, const ProblemManagerType& pm,
                                                  m_i( li, lj, lk, 0 ) -
                                              delta_g
                                        : 0.0;
-
-            // Apply the boundary condition.
-            bc( gi, gj, gk, u_i( li, lj, lk, 0 ), u_i( li, lj, lk, 1 ),
-                u_i( li, lj, lk, 2 ) );
         } );
+    tuner.stop( exec_space );
+
+    // Apply the boundary condition.
+    int chunk = tuner.start( exec_space, "field_solve_boundary_condition",
+                             local_nodes, Autotuner::num_chunk );
+    bc_nodes.apply( exec_space, "field_solve_boundary_condition", u_i,
+                    Autotuner::chunkSize( chunk ) );
+    tuner.stop( exec_space );
+
+    timer.stop( Phase::FIELD_SOLVE );
 }
 
 //---------------------------------------------------------------------------//
-// Grid-to-particle.
-template <class ProblemManagerType, class ExecutionSpace>
+// Grid-to-particle with a given scatter strategy.
+template <class ProblemManagerType, class ExecutionSpace, class StrategyTag>
 void g2p( const ExecutionSpace& exec_space, const ProblemManagerType& pm,
-          const double delta_t )
+          const double delta_t, Timer& timer, StrategyTag strategy )
 {
     // Get the particle data we need.
     auto m_p = pm.get( Location::Particle(), Field::Mass() );
@@ -183,11 +290,11 @@ void g2p( const ExecutionSpace& exec_space, const ProblemManagerType& pm,
 
     // Reset write views.
     Kokkos::deep_copy( r_c, 0.0 );
-    Kokkos::deep_copy( k_c, 0.0 );
+    Kokkos::deep_copy( k_c, 0 );
 
-    // Create the scatter views we need.
-    auto r_c_sv = Kokkos::Experimental::create_scatter_view( r_c );
-    auto k_c_sv = Kokkos::Experimental::create_scatter_view( k_c );
+    // Reset the scatter views we need.
+    auto r_c_sv = pm.getScatter( Location::Cell(), Field::Density(), strategy );
+    r_c_sv.reset_except( r_c );
 
     // Build the local mesh.
     auto local_mesh =
@@ -196,14 +303,26 @@ void g2p( const ExecutionSpace& exec_space, const ProblemManagerType& pm,
         pm.mesh()->localGrid()->globalGrid().globalMesh().cellSize( 0 );
     auto cell_volume = cell_size * cell_size * cell_size;
 
-    // Gather the data we need.
-    pm.gather( Location::Node(), Field::Velocity() );
+    // Gather the data we need. The ghost velocities are already valid after
+    // a redundant ghost solve.
+    if ( !pm.options().redundant_ghost_solve )
+    {
+        timer.start( Phase::VELOCITY_GATHER );
+        pm.gather( Location::Node(), Field::Velocity() );
+        timer.stop( Phase::VELOCITY_GATHER );
+    }
 
     // Loop over particles.
+    timer.start( Phase::G2P );
+    auto& tuner = pm.autotuner();
+    int chunk = tuner.start( exec_space, "g2p", pm.numParticle(),
+                             Autotuner::num_chunk );
     Kokkos::parallel_for(
         "g2p",
-        Kokkos::RangePolicy<ExecutionSpace>( exec_space, 0, pm.numParticle() ),
-        KOKKOS_LAMBDA( const int p ) {
+        setTunedChunkSize( ParticleRangePolicy<ExecutionSpace>(
+                               exec_space, 0, pm.numParticle() ),
+                           chunk ),
+        KOKKOS_LAMBDA( const ParticleIndex p ) {
             // Get the particle position.
             double x[3] = { x_p( p, 0 ), x_p( p, 1 ), x_p( p, 2 ) };
 
@@ -211,29 +330,28 @@ void g2p( const ExecutionSpace& exec_space, const ProblemManagerType& pm,
             Cajita::SplineData<double, 2, 3, Cajita::Node> sd_i;
             Cajita::evaluateSpline( local_mesh, x, sd_i );
 
-            // Update particle velocity.
+            // Update particle velocity and compute the velocity divergence
+            // (this is the trace of the velocity gradient) in one pass over
+            // the nodes.
             double vel_p[3];
             double aff_p[3][3];
-            APIC::g2p( u_i, sd_i, vel_p, aff_p );
+            double div_u;
+            APIC::g2pFull( u_i, sd_i, vel_p, aff_p, div_u );
             for ( int d = 0; d < 3; ++d )
                 u_p( p, d ) = vel_p[d];
             for ( int d0 = 0; d0 < 3; ++d0 )
                 for ( int d1 = 0; d1 < 3; ++d1 )
                     B_p( p, d0, d1 ) = aff_p[d0][d1];
 
-            // Compute the velocity divergence (this is the trace of the
-            // velocity gradient).
-            double div_u;
-            Cajita::G2P::divergence( u_i, sd_i, div_u );
-
             // Update the deformation gradient determinant.
             j_p( p ) *= exp( delta_t * div_u );
 
-            // Move the particle
+            // Move the particle. The stored position is updated in place so
+            // packed positions move in cell units.
             for ( int d = 0; d < 3; ++d )
             {
                 x[d] += delta_t * vel_p[d];
-                x_p( p, d ) = x[d];
+                x_p( p, d ) += delta_t * vel_p[d];
             }
 
             // Project density to cell.
@@ -241,29 +359,51 @@ void g2p( const ExecutionSpace& exec_space, const ProblemManagerType& pm,
             Cajita::evaluateSpline( local_mesh, x, sd_c1 );
             Cajita::P2G::value( m_p( p ) / cell_volume, sd_c1, r_c_sv );
 
-            // Mark cells. Indicates whether or not cells have particles.
-            Cajita::SplineData<double, 0, 3, Cajita::Cell> sd_c0;
-            Cajita::evaluateSpline( local_mesh, x, sd_c0 );
-            Cajita::P2G::value( 1.0, sd_c0, k_c_sv );
+            // Mark cells. Indicates whether or not cells have particles. The
+            // cell containing the particle is the cell of the density
+            // stencil with the larger weight in each dimension. All writers
+            // store the same value so no atomics are needed.
+            int c[3];
+            for ( int d = 0; d < 3; ++d )
+                c[d] = ( sd_c1.w[d][0] > 0.5 ) ? sd_c1.s[d][0] : sd_c1.s[d][1];
+            k_c( c[0], c[1], c[2], 0 ) = 1;
         } );
+    tuner.stop( exec_space );
 
     // Complete local scatter.
     Kokkos::Experimental::contribute( r_c, r_c_sv );
-    Kokkos::Experimental::contribute( k_c, k_c_sv );
+    timer.stop( Phase::G2P );
 
     // Complete global scatter.
-    pm.scatter( Location::Cell(), Field::Density() );
-    pm.scatter( Location::Cell(), Field::Mark() );
+    timer.start( Phase::HALO_SCATTER );
+    pm.scatter( Location::Cell(), Field::Density(), Field::Mark() );
+    timer.stop( Phase::HALO_SCATTER );
 }
 
 //---------------------------------------------------------------------------//
-// Correct particle positions.
+// Grid-to-particle.
 template <class ProblemManagerType, class ExecutionSpace>
+void g2p( const ExecutionSpace& exec_space, const ProblemManagerType& pm,
+          const double delta_t, Timer& timer )
+{
+    if ( pm.scatterDuplicated( Location::Cell() ) )
+        g2p( exec_space, pm, delta_t, timer, Scatter::Duplicated() );
+    else
+        g2p( exec_space, pm, delta_t, timer, Scatter::Atomic() );
+}
+
+//---------------------------------------------------------------------------//
+// Correct particle positions.
+template <class ProblemManagerType, class ExecutionSpace,
+          class BoundaryNodeListType>
 void correctParticlePositions( const ExecutionSpace& exec_space,
                                const ProblemManagerType& pm,
                                const double delta_t,
-                               const BoundaryCondition& bc )
+                               const BoundaryNodeListType& bc_nodes,
+                               Timer& timer )
 {
+    timer.start( Phase::POSITION_CORRECTION );
+
     // Get the particle data we need.
     auto x_p = pm.get( Location::Particle(), Field::Position() );
 
@@ -272,12 +412,6 @@ void correctParticlePositions( const ExecutionSpace& exec_space,
     auto k_c = pm.get( Location::Cell(), Field::Mark() );
     auto x_i = pm.get( Location::Node(), Field::PositionCorrection() );
 
-    // Reset write views.
-    Kokkos::deep_copy( x_i, 0.0 );
-
-    // Create the scatter views we need.
-    auto x_i_sv = Kokkos::Experimental::create_scatter_view( x_i );
-
     // Get the fluid properties.
     double kappa = pm.kappa();
     double density = pm.density();
@@ -286,62 +420,89 @@ void correctParticlePositions( const ExecutionSpace& exec_space,
     auto local_mesh =
         Cajita::createLocalMesh<ExecutionSpace>( *( pm.mesh()->localGrid() ) );
 
-    // Compute nodal correction.
-    auto local_cells = pm.mesh()->localGrid()->indexSpace(
+    // Cell centers are always halfway between their nodes so the order-1
+    // spline gradient from a cell center to each of its nodes is constant:
+    // +/-1/dx in the gradient dimension times weights of 1/2 in the others.
+    auto cell_size =
+        pm.mesh()->localGrid()->globalGrid().globalMesh().cellSize( 0 );
+    double gradient_scale = 0.25 / cell_size;
+
+    // Compute nodal correction by gathering from the 8 cells around each
+    // node. Only owned cells contribute. The contributions of the ghost
+    // cells are summed in by the halo exchange.
+    auto owned_cells = pm.mesh()->localGrid()->indexSpace(
         Cajita::Own(), Cajita::Cell(), Cajita::Local() );
+    int owned_min[3] = { static_cast<int>( owned_cells.min( 0 ) ),
+                         static_cast<int>( owned_cells.min( 1 ) ),
+                         static_cast<int>( owned_cells.min( 2 ) ) };
+    int owned_max[3] = { static_cast<int>( owned_cells.max( 0 ) ),
+                         static_cast<int>( owned_cells.max( 1 ) ),
+                         static_cast<int>( owned_cells.max( 2 ) ) };
+    auto local_nodes = pm.mesh()->localGrid()->indexSpace(
+        Cajita::Ghost(), Cajita::Node(), Cajita::Local() );
+    auto& tuner = pm.autotuner();
+    int tile = tuner.start( exec_space, "compute_position_correction",
+                            local_nodes, Autotuner::num_tile );
     Kokkos::parallel_for(
         "compute_position_correction",
-        Cajita::createExecutionPolicy( local_cells, exec_space ),
+        createTunedPolicy( local_nodes, exec_space, tile ),
         KOKKOS_LAMBDA( const int i, const int j, const int k ) {
-            // Get the cell center.
-            int idx[3] = { i, j, k };
-            double x[3];
-            local_mesh.coordinates( Cajita::Cell(), idx, x );
-
-            // Setup interpolation from cell center to nodes.
-            Cajita::SplineData<double, 1, 3, Cajita::Node> sd_i;
-            Cajita::evaluateSpline( local_mesh, x, sd_i );
-
-            // Clamp the density outside the fluid.
-            double rho = ( k_c( i, j, k, 0 ) > 0.0 )
-                             ? r_c( i, j, k, 0 )
-                             : fmax( r_c( i, j, k, 0 ), density );
-
-            // Compute correction.
-            double correction =
-                -delta_t * delta_t * kappa * ( 1 - rho / density ) / density;
-            Cajita::P2G::gradient( correction, sd_i, x_i_sv );
+            double gradient[3] = { 0.0, 0.0, 0.0 };
+            for ( int a = 0; a < 2; ++a )
+                for ( int b = 0; b < 2; ++b )
+                    for ( int c = 0; c < 2; ++c )
+                    {
+                        // Cell a is below the node in the first dimension
+                        // when a is 0 and above it when a is 1, and the
+                        // same for b and c.
+                        int ci = i - 1 + a;
+                        int cj = j - 1 + b;
+                        int ck = k - 1 + c;
+                        if ( ci >= owned_min[0] && ci < owned_max[0] &&
+                             cj >= owned_min[1] && cj < owned_max[1] &&
+                             ck >= owned_min[2] && ck < owned_max[2] )
+                        {
+                            // Clamp the density outside the fluid.
+                            double rho =
+                                ( k_c( ci, cj, ck, 0 ) > 0 )
+                                    ? r_c( ci, cj, ck, 0 )
+                                    : fmax( r_c( ci, cj, ck, 0 ), density );
+
+                            // Compute correction.
+                            double correction = -delta_t * delta_t * kappa *
+                                                ( 1 - rho / density ) /
+                                                density;
+                            gradient[0] += a ? -correction : correction;
+                            gradient[1] += b ? -correction : correction;
+                            gradient[2] += c ? -correction : correction;
+                        }
+                    }
+            for ( int d = 0; d < 3; ++d )
+                x_i( i, j, k, d ) = gradient_scale * gradient[d];
         } );
+    tuner.stop( exec_space );
 
-    // Complete local scatter.
-    Kokkos::Experimental::contribute( x_i, x_i_sv );
-
-    // Complete global scatter.
-    pm.scatter( Location::Node(), Field::PositionCorrection() );
-
-    // Gather the position correction.
-    pm.gather( Location::Node(), Field::PositionCorrection() );
+    // Complete the global scatter and gather the position correction in a
+    // single exchange.
+    pm.scatterGather( Location::Node(), Field::PositionCorrection() );
 
     // Apply boundary condition to position correction.
-    // Compute the velocity.
-    auto l2g = Cajita::IndexConversion::createL2G( *( pm.mesh()->localGrid() ),
-                                                   Cajita::Node() );
-    auto local_nodes = pm.mesh()->localGrid()->indexSpace(
-        Cajita::Ghost(), Cajita::Node(), Cajita::Local() );
-    Kokkos::parallel_for(
-        Cajita::createExecutionPolicy( local_nodes, exec_space ),
-        KOKKOS_LAMBDA( const int li, const int lj, const int lk ) {
-            int gi, gj, gk;
-            l2g( li, lj, lk, gi, gj, gk );
-            bc( gi, gj, gk, x_i( li, lj, lk, 0 ), x_i( li, lj, lk, 1 ),
-                x_i( li, lj, lk, 2 ) );
-        } );
+    int chunk =
+        tuner.start( exec_space, "position_correction_boundary_condition",
+                     local_nodes, Autotuner::num_chunk );
+    bc_nodes.apply( exec_space, "position_correction_boundary_condition",
+                    x_i, Autotuner::chunkSize( chunk ) );
+    tuner.stop( exec_space );
 
     // Update particle positions.
+    chunk = tuner.start( exec_space, "correct_particles", pm.numParticle(),
+                         Autotuner::num_chunk );
     Kokkos::parallel_for(
         "correct_particles",
-        Kokkos::RangePolicy<ExecutionSpace>( exec_space, 0, pm.numParticle() ),
-        KOKKOS_LAMBDA( const int p ) {
+        setTunedChunkSize( ParticleRangePolicy<ExecutionSpace>(
+                               exec_space, 0, pm.numParticle() ),
+                           chunk ),
+        KOKKOS_LAMBDA( const ParticleIndex p ) {
             // Get the particle position.
             double x[3] = { x_p( p, 0 ), x_p( p, 1 ), x_p( p, 2 ) };
 
@@ -355,19 +516,38 @@ void correctParticlePositions( const ExecutionSpace& exec_space,
             for ( int d = 0; d < 3; ++d )
                 x_p( p, d ) += delta_x[d];
         } );
+    tuner.stop( exec_space );
+
+    timer.stop( Phase::POSITION_CORRECTION );
 }
 
 //---------------------------------------------------------------------------//
 // Take a time step.
-template <class ProblemManagerType, class ExecutionSpace>
+template <class ProblemManagerType, class ExecutionSpace,
+          class BoundaryNodeListType>
 void step( const ExecutionSpace& exec_space, const ProblemManagerType& pm,
            const double delta_t, const double gravity,
-           const BoundaryCondition& bc )
+           const BoundaryNodeListType& bc_nodes, Timer& timer )
 {
-    p2g( exec_space, pm );
-    fieldSolve( exec_space, pm, delta_t, gravity, bc );
-    g2p( exec_space, pm, delta_t );
-    correctParticlePositions( exec_space, pm, delta_t, bc );
+    Kokkos::Profiling::pushRegion( "TimeIntegrator::step" );
+
+    Kokkos::Profiling::pushRegion( "TimeIntegrator::p2g" );
+    p2g( exec_space, pm, delta_t, timer );
+    Kokkos::Profiling::popRegion();
+
+    Kokkos::Profiling::pushRegion( "TimeIntegrator::fieldSolve" );
+    fieldSolve( exec_space, pm, delta_t, gravity, bc_nodes, timer );
+    Kokkos::Profiling::popRegion();
+
+    Kokkos::Profiling::pushRegion( "TimeIntegrator::g2p" );
+    g2p( exec_space, pm, delta_t, timer );
+    Kokkos::Profiling::popRegion();
+
+    Kokkos::Profiling::pushRegion( "TimeIntegrator::correctParticlePositions" );
+    correctParticlePositions( exec_space, pm, delta_t, bc_nodes, timer );
+    Kokkos::Profiling::popRegion();
+
+    Kokkos::Profiling::popRegion();
 }
 
 //---------------------------------------------------------------------------//
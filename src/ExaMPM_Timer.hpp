@@ -0,0 +1,205 @@
+/****************************************************************************
+ * Copyright (c) 2018-2020 by the ExaMPM authors                            *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the ExaMPM library. ExaMPM is distributed under a   *
+ * BSD 3-clause license. For the licensing terms see the LICENSE file in    *
+ * the top-level directory.                                                 *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#ifndef EXAMPM_TIMER_HPP
+#define EXAMPM_TIMER_HPP
+
+#include <Kokkos_Core.hpp>
+
+#include <mpi.h>
+
+#include <array>
+#include <cstdio>
+
+namespace ExaMPM
+{
+//---------------------------------------------------------------------------//
+// Timed phases of a time step.
+struct Phase
+{
+    enum Values
+    {
+        P2G = 0,
+        P2G_CONTRIBUTE = 1,
+        HALO_SCATTER = 2,
+        FIELD_SOLVE = 3,
+        VELOCITY_GATHER = 4,
+        G2P = 5,
+        POSITION_CORRECTION = 6,
+        PARTICLE_MIGRATION = 7,
+        OUTPUT = 8,
+        TOTAL = 9,
+        NUM_PHASE = 10
+    };
+
+    static const char* name( const int phase )
+    {
+        static const char* names[NUM_PHASE] = {
+            "p2g",         "p2g_contribute",      "halo_scatter",
+            "field_solve", "velocity_gather",     "g2p",
+            "position_correction", "particle_migration", "output",
+            "total" };
+        return names[phase];
+    }
+};
+
+//---------------------------------------------------------------------------//
+/*!
+  \class Timer
+  \brief Accumulated wall time of each phase of a time step.
+
+  When fencing is enabled the execution space is fenced at the start and end
+  of each phase so asynchronous backends are charged to the phase that
+  launched the work.
+*/
+class Timer
+{
+  public:
+    Timer( const bool fence = false )
+        : _fence( fence )
+        , _particle_updates( 0 )
+    {
+        reset();
+    }
+
+    // Enable or disable fencing around timed phases.
+    void setFence( const bool fence ) { _fence = fence; }
+
+    bool fence() const { return _fence; }
+
+    // Clear all accumulated times.
+    void reset()
+    {
+        _start.fill( 0.0 );
+        _seconds.fill( 0.0 );
+        _count.fill( 0 );
+        _particle_updates = 0;
+        _clock.reset();
+    }
+
+    // Start a phase.
+    void start( const int phase )
+    {
+        if ( _fence )
+            Kokkos::fence();
+        _start[phase] = _clock.seconds();
+    }
+
+    // Stop a phase and accumulate its time.
+    void stop( const int phase )
+    {
+        if ( _fence )
+            Kokkos::fence();
+        _seconds[phase] += _clock.seconds() - _start[phase];
+        ++_count[phase];
+    }
+
+    // Accumulated local time of a phase.
+    double seconds( const int phase ) const { return _seconds[phase]; }
+
+    // Number of times a phase was timed.
+    long count( const int phase ) const { return _count[phase]; }
+
+    // Record the number of particles advanced in a step.
+    void addParticleUpdates( const long num_particle )
+    {
+        _particle_updates += num_particle;
+    }
+
+    long particleUpdates() const { return _particle_updates; }
+
+    // Reduce the time of each phase over all ranks. The results are only
+    // valid on rank 0 of the communicator.
+    void reduce( MPI_Comm comm,
+                 std::array<double, Phase::NUM_PHASE>& min_seconds,
+                 std::array<double, Phase::NUM_PHASE>& avg_seconds,
+                 std::array<double, Phase::NUM_PHASE>& max_seconds ) const
+    {
+        int comm_size;
+        MPI_Comm_size( comm, &comm_size );
+
+        MPI_Reduce( _seconds.data(), min_seconds.data(), Phase::NUM_PHASE,
+                    MPI_DOUBLE, MPI_MIN, 0, comm );
+        MPI_Reduce( _seconds.data(), avg_seconds.data(), Phase::NUM_PHASE,
+                    MPI_DOUBLE, MPI_SUM, 0, comm );
+        MPI_Reduce( _seconds.data(), max_seconds.data(), Phase::NUM_PHASE,
+                    MPI_DOUBLE, MPI_MAX, 0, comm );
+        for ( auto& s : avg_seconds )
+            s /= comm_size;
+    }
+
+    // Total number of particle updates over all ranks. The result is only
+    // valid on rank 0 of the communicator.
+    long globalParticleUpdates( MPI_Comm comm ) const
+    {
+        long global_updates = 0;
+        MPI_Reduce( &_particle_updates, &global_updates, 1, MPI_LONG, MPI_SUM,
+                    0, comm );
+        return global_updates;
+    }
+
+    // Print the min/avg/max time of each phase over all ranks and the global
+    // particle update throughput on rank 0. The throughput is reported over
+    // the compute phases, which does not depend on the output frequency, and
+    // over the total step time.
+    void report( MPI_Comm comm ) const
+    {
+        int comm_rank;
+        MPI_Comm_rank( comm, &comm_rank );
+
+        std::array<double, Phase::NUM_PHASE> min_seconds;
+        std::array<double, Phase::NUM_PHASE> avg_seconds;
+        std::array<double, Phase::NUM_PHASE> max_seconds;
+        reduce( comm, min_seconds, avg_seconds, max_seconds );
+        long global_updates = globalParticleUpdates( comm );
+
+        // The compute phases are disjoint so their sum is the time of a step
+        // without output and diagnostics.
+        double local_compute = 0.0;
+        for ( int p = Phase::P2G; p <= Phase::PARTICLE_MIGRATION; ++p )
+            local_compute += _seconds[p];
+        double compute = 0.0;
+        MPI_Reduce( &local_compute, &compute, 1, MPI_DOUBLE, MPI_MAX, 0,
+                    comm );
+
+        if ( 0 != comm_rank )
+            return;
+
+        printf( "\n%-20s %12s %12s %12s %8s\n", "phase", "min (s)", "avg (s)",
+                "max (s)", "calls" );
+        for ( int p = 0; p < Phase::NUM_PHASE; ++p )
+            printf( "%-20s %12.4e %12.4e %12.4e %8ld\n", Phase::name( p ),
+                    min_seconds[p], avg_seconds[p], max_seconds[p],
+                    _count[p] );
+
+        double total = max_seconds[Phase::TOTAL];
+        printf( "\nparticle updates: %ld\n", global_updates );
+        printf( "particle updates per second (compute): %.4e\n",
+                ( compute > 0.0 ) ? global_updates / compute : 0.0 );
+        printf( "particle updates per second (total): %.4e\n",
+                ( total > 0.0 ) ? global_updates / total : 0.0 );
+        printf( "fenced timers: %s\n\n", _fence ? "yes" : "no" );
+    }
+
+  private:
+    bool _fence;
+    Kokkos::Timer _clock;
+    std::array<double, Phase::NUM_PHASE> _start;
+    std::array<double, Phase::NUM_PHASE> _seconds;
+    std::array<long, Phase::NUM_PHASE> _count;
+    long _particle_updates;
+};
+
+//---------------------------------------------------------------------------//
+
+} // end namespace ExaMPM
+
+#endif // EXAMPM_TIMER_HPP
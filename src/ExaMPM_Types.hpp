@@ -12,14 +12,36 @@
 #ifndef EXAMPM_TYPES_HPP
 #define EXAMPM_TYPES_HPP
 
+#include <ExaMPM_Config.hpp>
+
 #include <Cajita.hpp>
 
+#include <Kokkos_Core.hpp>
+
+#include <cstdint>
+
 namespace ExaMPM
 {
 //---------------------------------------------------------------------------//
 // Logical dimension index.
 using Dim = Cajita::Dim;
 
+//---------------------------------------------------------------------------//
+// Particle index and count type. Configure with
+// ExaMPM_ENABLE_64BIT_PARTICLE_INDEX to hold more than 2^31 particles on a
+// rank.
+#ifdef ExaMPM_ENABLE_64BIT_PARTICLE_INDEX
+using ParticleIndex = std::int64_t;
+#else
+using ParticleIndex = int;
+#endif
+
+//---------------------------------------------------------------------------//
+// Range policy over the particles of a rank.
+template <class ExecutionSpace>
+using ParticleRangePolicy =
+    Kokkos::RangePolicy<ExecutionSpace, Kokkos::IndexType<ParticleIndex>>;
+
 //---------------------------------------------------------------------------//
 
 } // end namespace ExaMPM
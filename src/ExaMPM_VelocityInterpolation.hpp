@@ -199,9 +199,137 @@ g2p( const VelocityView& node_velocity, const SplineDataType& sd,
             }
 }
 
+//---------------------------------------------------------------------------//
+// Interpolate grid node velocity to the particle and compute the velocity
+// divergence in the same pass. Each node velocity is read once.
+template <class SplineDataType, class VelocityView>
+KOKKOS_INLINE_FUNCTION void
+g2pFull( const VelocityView& node_velocity, const SplineDataType& sd,
+         typename VelocityView::value_type u_p[3],
+         typename VelocityView::value_type B_p[3][3],
+         typename VelocityView::value_type& div_u,
+         typename std::enable_if<
+             Cajita::isNode<typename SplineDataType::entity_type>::value,
+             void*>::type = 0 )
+{
+    using value_type = typename VelocityView::value_type;
+
+    for ( int d = 0; d < 3; ++d )
+        u_p[d] = 0.0;
+
+    for ( int d0 = 0; d0 < 3; ++d0 )
+        for ( int d1 = 0; d1 < 3; ++d1 )
+            B_p[d0][d1] = 0.0;
+
+    div_u = 0.0;
+
+    value_type distance[3];
+    value_type u_i[3];
+    value_type w_ip;
+    value_type g_ip[3];
+
+    for ( int i = 0; i < SplineDataType::num_knot; ++i )
+        for ( int j = 0; j < SplineDataType::num_knot; ++j )
+            for ( int k = 0; k < SplineDataType::num_knot; ++k )
+            {
+                // Node velocity.
+                for ( int d = 0; d < 3; ++d )
+                    u_i[d] = node_velocity( sd.s[Dim::I][i], sd.s[Dim::J][j],
+                                            sd.s[Dim::K][k], d );
+
+                // Projection weight.
+                w_ip = sd.w[Dim::I][i] * sd.w[Dim::J][j] * sd.w[Dim::K][k];
+
+                // Projection weight gradient.
+                g_ip[Dim::I] =
+                    sd.g[Dim::I][i] * sd.w[Dim::J][j] * sd.w[Dim::K][k];
+                g_ip[Dim::J] =
+                    sd.w[Dim::I][i] * sd.g[Dim::J][j] * sd.w[Dim::K][k];
+                g_ip[Dim::K] =
+                    sd.w[Dim::I][i] * sd.w[Dim::J][j] * sd.g[Dim::K][k];
+
+                // Physical distance to entity.
+                distance[Dim::I] = sd.d[Dim::I][i];
+                distance[Dim::J] = sd.d[Dim::J][j];
+                distance[Dim::K] = sd.d[Dim::K][k];
+
+                for ( int d0 = 0; d0 < 3; ++d0 )
+                {
+                    // Update velocity.
+                    u_p[d0] += w_ip * u_i[d0];
+
+                    // Update affine matrix.
+                    for ( int d1 = 0; d1 < 3; ++d1 )
+                        B_p[d0][d1] += w_ip * u_i[d0] * distance[d1];
+
+                    // Update divergence.
+                    div_u += g_ip[d0] * u_i[d0];
+                }
+            }
+}
+
 //---------------------------------------------------------------------------//
 
 } // end namespace APIC
+
+namespace MLS
+{
+//---------------------------------------------------------------------------//
+// Interpolate particle momentum and the stress impulse to the nodes. The
+// affine momentum matrix combines the APIC affine momentum and the time step
+// times the stress contribution, both scaled by the inverse inertial tensor,
+// so the grid momentum includes the force update. (Second and Third order
+// splines)
+template <class SplineDataType, class MomentumView>
+KOKKOS_INLINE_FUNCTION void
+p2g( const typename MomentumView::original_value_type m_p,
+     const typename MomentumView::original_value_type u_p[3],
+     const typename MomentumView::original_value_type C_p[3][3],
+     const SplineDataType& sd, const MomentumView& node_momentum,
+     typename std::enable_if<
+         ( Cajita::isNode<typename SplineDataType::entity_type>::value &&
+           ( SplineDataType::order == 2 || SplineDataType::order == 3 ) ),
+         void*>::type = 0 )
+{
+    static_assert( Cajita::P2G::is_scatter_view<MomentumView>::value,
+                   "P2G requires a Kokkos::ScatterView" );
+    auto momentum_access = node_momentum.access();
+
+    using value_type = typename MomentumView::original_value_type;
+
+    // Particle momentum.
+    value_type mu_p[3] = { m_p * u_p[0], m_p * u_p[1], m_p * u_p[2] };
+
+    // Project momentum.
+    value_type distance[3];
+    value_type C_p_d[3];
+    value_type w_ip;
+    for ( int i = 0; i < SplineDataType::num_knot; ++i )
+        for ( int j = 0; j < SplineDataType::num_knot; ++j )
+            for ( int k = 0; k < SplineDataType::num_knot; ++k )
+            {
+                // Physical distance to entity.
+                distance[Dim::I] = sd.d[Dim::I][i];
+                distance[Dim::J] = sd.d[Dim::J][j];
+                distance[Dim::K] = sd.d[Dim::K][k];
+
+                // Compute the action of C_p on the distance.
+                DenseLinearAlgebra::matVecMultiply( C_p, distance, C_p_d );
+
+                // Weight.
+                w_ip = sd.w[Dim::I][i] * sd.w[Dim::J][j] * sd.w[Dim::K][k];
+
+                // Interpolate particle momentum to the entity.
+                for ( int d = 0; d < 3; ++d )
+                    momentum_access( sd.s[Dim::I][i], sd.s[Dim::J][j],
+                                     sd.s[Dim::K][k], d ) +=
+                        w_ip * ( mu_p[d] + C_p_d[d] );
+            }
+}
+
+//---------------------------------------------------------------------------//
+
+} // end namespace MLS
 } // end namespace ExaMPM
 
 #endif // end EXAMPM_VELOCITYINTERPOLATION_HPP
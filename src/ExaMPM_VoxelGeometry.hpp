@@ -0,0 +1,383 @@
+/****************************************************************************
+ * Copyright (c) 2018-2020 by the ExaMPM authors                            *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the ExaMPM library. ExaMPM is distributed under a   *
+ * BSD 3-clause license. For the licensing terms see the LICENSE file in    *
+ * the top-level directory.                                                 *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#ifndef EXAMPM_VOXELGEOMETRY_HPP
+#define EXAMPM_VOXELGEOMETRY_HPP
+
+#include <ExaMPM_Types.hpp>
+
+#include <Cajita.hpp>
+
+#include <Kokkos_Core.hpp>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+namespace ExaMPM
+{
+//---------------------------------------------------------------------------//
+// Voxel file header. A voxel file is this header followed by one value per
+// voxel with the I index running fastest:
+//
+//     value( i, j, k ) at byte
+//         sizeof(VoxelFileHeader) + size * ( i + nx * ( j + ny * k ) )
+//
+// Occupancy files store one byte per voxel with non-zero values inside the
+// geometry. Signed distance files store one float per voxel with negative
+// values inside the geometry. All values are in native byte order.
+struct VoxelFileHeader
+{
+    enum Type
+    {
+        OCCUPANCY = 0,
+        SIGNED_DISTANCE = 1
+    };
+
+    char magic[8];
+    std::int32_t version;
+    std::int32_t type;
+    std::int32_t num_voxel[3];
+    std::int32_t padding;
+    double low_corner[3];
+    double spacing;
+
+    static const char* expectedMagic() { return "EXAVOXEL"; }
+
+    std::size_t valueSize() const
+    {
+        return ( SIGNED_DISTANCE == type ) ? sizeof( float ) : 1;
+    }
+};
+
+static_assert( sizeof( VoxelFileHeader ) == 64,
+               "Voxel file header must be 64 bytes" );
+
+//---------------------------------------------------------------------------//
+/*!
+  \class VoxelMask
+  \brief Rank-local block of a voxel geometry resident in a memory space.
+
+  Points are classified by the voxel containing them. Points outside of the
+  block are outside of the geometry.
+*/
+template <class MemorySpace>
+class VoxelMask
+{
+  public:
+    using memory_space = MemorySpace;
+
+    VoxelMask() = default;
+
+    VoxelMask( const Kokkos::View<unsigned char***, MemorySpace>& mask,
+               const Kokkos::Array<double, 3>& low_corner,
+               const double spacing,
+               const Kokkos::Array<double, 6>& bounding_box )
+        : _mask( mask )
+        , _low_corner( low_corner )
+        , _inv_spacing( 1.0 / spacing )
+        , _bounding_box( bounding_box )
+    {
+    }
+
+    // Bounding box of the occupied voxels in the block.
+    Kokkos::Array<double, 6> boundingBox() const { return _bounding_box; }
+
+    // Determine if a point is inside of the geometry.
+    KOKKOS_INLINE_FUNCTION
+    bool inside( const double x[3] ) const
+    {
+        int index[3];
+        for ( int d = 0; d < 3; ++d )
+        {
+            double v = ( x[d] - _low_corner[d] ) * _inv_spacing;
+            if ( v < 0.0 || v >= static_cast<double>( _mask.extent( d ) ) )
+                return false;
+            index[d] = static_cast<int>( v );
+        }
+        return _mask( index[Dim::I], index[Dim::J], index[Dim::K] );
+    }
+
+  private:
+    Kokkos::View<unsigned char***, MemorySpace> _mask;
+    Kokkos::Array<double, 3> _low_corner;
+    double _inv_spacing;
+    Kokkos::Array<double, 6> _bounding_box;
+};
+
+//---------------------------------------------------------------------------//
+/*!
+  \class VoxelGeometry
+  \brief Voxelized geometry stored in a file.
+
+  Construction only reads the file header. Each rank then loads the block of
+  voxels covering its owned cells by memory mapping only the page-aligned
+  byte ranges of the rows of that block, so startup cost and address space
+  are proportional to the rank's share of the geometry rather than to the
+  size of the file.
+*/
+class VoxelGeometry
+{
+  public:
+    explicit VoxelGeometry( const std::string& file_name )
+        : _file_name( file_name )
+    {
+        int fd = open( _file_name.c_str(), O_RDONLY );
+        if ( fd < 0 )
+            throw std::runtime_error( "Unable to open voxel file " +
+                                      _file_name );
+
+        struct stat file_stat;
+        bool valid =
+            ( 0 == fstat( fd, &file_stat ) ) &&
+            ( static_cast<ssize_t>( sizeof( VoxelFileHeader ) ) ==
+              pread( fd, &_header, sizeof( VoxelFileHeader ), 0 ) );
+        close( fd );
+        if ( !valid )
+            throw std::runtime_error( "Unable to read voxel file header " +
+                                      _file_name );
+
+        if ( 0 != std::strncmp( _header.magic, VoxelFileHeader::expectedMagic(),
+                                8 ) ||
+             1 != _header.version )
+            throw std::runtime_error( "Invalid voxel file " + _file_name );
+        if ( VoxelFileHeader::OCCUPANCY != _header.type &&
+             VoxelFileHeader::SIGNED_DISTANCE != _header.type )
+            throw std::runtime_error( "Unknown voxel type in " + _file_name );
+        if ( !( _header.spacing > 0.0 ) )
+            throw std::runtime_error( "Invalid voxel spacing in " +
+                                      _file_name );
+
+        std::size_t num_voxel = 1;
+        for ( int d = 0; d < 3; ++d )
+        {
+            if ( _header.num_voxel[d] <= 0 )
+                throw std::runtime_error( "Invalid voxel dimensions in " +
+                                          _file_name );
+            num_voxel *= _header.num_voxel[d];
+        }
+        if ( static_cast<std::size_t>( file_stat.st_size ) <
+             sizeof( VoxelFileHeader ) + num_voxel * _header.valueSize() )
+            throw std::runtime_error( "Truncated voxel file " + _file_name );
+    }
+
+    const VoxelFileHeader& header() const { return _header; }
+
+    // Load the block of voxels covering the owned cells of the local grid
+    // into the given memory space.
+    template <class MemorySpace, class LocalGridType>
+    VoxelMask<MemorySpace> load( const LocalGridType& local_grid ) const
+    {
+        const auto& global_grid = local_grid.globalGrid();
+        const auto& global_mesh = global_grid.globalMesh();
+        auto owned_cells = local_grid.indexSpace( Cajita::Own(), Cajita::Cell(),
+                                                  Cajita::Local() );
+
+        // Voxels touching the owned cells.
+        long voxel_min[3];
+        long voxel_max[3];
+        for ( int d = 0; d < 3; ++d )
+        {
+            double dx = global_mesh.cellSize( d );
+            double owned_low = global_mesh.lowCorner( d ) +
+                               dx * global_grid.globalOffset( d );
+            double owned_high = owned_low + dx * owned_cells.extent( d );
+            double n = _header.num_voxel[d];
+            double v_low = std::floor( ( owned_low - _header.low_corner[d] ) /
+                                       _header.spacing );
+            double v_high = std::ceil( ( owned_high - _header.low_corner[d] ) /
+                                       _header.spacing );
+            voxel_min[d] =
+                static_cast<long>( std::min( std::max( v_low, 0.0 ), n ) );
+            voxel_max[d] =
+                static_cast<long>( std::min( std::max( v_high, 0.0 ), n ) );
+            voxel_max[d] = std::max( voxel_max[d], voxel_min[d] );
+        }
+
+        // Host copy of the block. Voxels inside the geometry are set to 1.
+        using mask_type = Kokkos::View<unsigned char***, MemorySpace>;
+        Kokkos::View<unsigned char***, typename mask_type::array_layout,
+                     Kokkos::HostSpace>
+            host_mask( "voxel_mask", voxel_max[Dim::I] - voxel_min[Dim::I],
+                       voxel_max[Dim::J] - voxel_min[Dim::J],
+                       voxel_max[Dim::K] - voxel_min[Dim::K] );
+
+        // Bounding box of the occupied voxels in index space.
+        long occupied_min[3] = { std::numeric_limits<long>::max(),
+                                 std::numeric_limits<long>::max(),
+                                 std::numeric_limits<long>::max() };
+        long occupied_max[3] = { std::numeric_limits<long>::lowest(),
+                                 std::numeric_limits<long>::lowest(),
+                                 std::numeric_limits<long>::lowest() };
+
+        if ( host_mask.size() > 0 )
+            readBlock( voxel_min, voxel_max, host_mask, occupied_min,
+                       occupied_max );
+
+        // Physical bounds of the block and of its occupied voxels. An empty
+        // block gets an inverted box so no cells are initialized.
+        Kokkos::Array<double, 3> low_corner;
+        Kokkos::Array<double, 6> bounding_box;
+        for ( int d = 0; d < 3; ++d )
+        {
+            low_corner[d] =
+                _header.low_corner[d] + _header.spacing * voxel_min[d];
+            bool empty = occupied_max[d] < occupied_min[d];
+            bounding_box[d] =
+                empty ? std::numeric_limits<double>::max()
+                      : _header.low_corner[d] +
+                            _header.spacing * occupied_min[d];
+            bounding_box[d + 3] =
+                empty ? std::numeric_limits<double>::lowest()
+                      : _header.low_corner[d] +
+                            _header.spacing * ( occupied_max[d] + 1 );
+        }
+
+        mask_type mask =
+            Kokkos::create_mirror_view_and_copy( MemorySpace(), host_mask );
+
+        return VoxelMask<MemorySpace>( mask, low_corner,
+                                       _header.spacing, bounding_box );
+    }
+
+  private:
+    // Map the rows of a block of voxels and copy them into the host mask.
+    // Each row of the block along I is a contiguous byte range of the file.
+    // The page-aligned ranges of consecutive rows are merged when they touch
+    // so a block spanning whole rows is mapped with a few large mappings
+    // while a block that is decomposed in I only maps its own rows.
+    template <class HostMask>
+    void readBlock( const long voxel_min[3], const long voxel_max[3],
+                    const HostMask& host_mask, long occupied_min[3],
+                    long occupied_max[3] ) const
+    {
+        const std::size_t value_size = _header.valueSize();
+        const long nx = _header.num_voxel[Dim::I];
+        const long ny = _header.num_voxel[Dim::J];
+        auto voxel_offset = [&]( const long i, const long j, const long k ) {
+            return sizeof( VoxelFileHeader ) +
+                   value_size * ( i + nx * ( j + ny * k ) );
+        };
+        const std::size_t page_size = sysconf( _SC_PAGE_SIZE );
+
+        int fd = open( _file_name.c_str(), O_RDONLY );
+        if ( fd < 0 )
+            throw std::runtime_error( "Unable to open voxel file " +
+                                      _file_name );
+
+        // Rows of the block in (j,k) order and the byte offset of each.
+        const long num_row_j = voxel_max[Dim::J] - voxel_min[Dim::J];
+        const long num_row =
+            num_row_j * ( voxel_max[Dim::K] - voxel_min[Dim::K] );
+        const std::size_t row_bytes =
+            value_size * ( voxel_max[Dim::I] - voxel_min[Dim::I] );
+        auto row_begin = [&]( const long r ) {
+            return voxel_offset( voxel_min[Dim::I],
+                                 voxel_min[Dim::J] + r % num_row_j,
+                                 voxel_min[Dim::K] + r / num_row_j );
+        };
+        auto page_begin = [&]( const std::size_t offset ) {
+            return ( offset / page_size ) * page_size;
+        };
+
+        long first_row = 0;
+        while ( first_row < num_row )
+        {
+            // Merge the following rows whose pages touch this mapping.
+            std::size_t map_begin = page_begin( row_begin( first_row ) );
+            std::size_t map_end = row_begin( first_row ) + row_bytes;
+            long last_row = first_row + 1;
+            while ( last_row < num_row &&
+                    page_begin( row_begin( last_row ) ) <= map_end )
+            {
+                map_end = row_begin( last_row ) + row_bytes;
+                ++last_row;
+            }
+
+            void* map = mmap( nullptr, map_end - map_begin, PROT_READ,
+                              MAP_PRIVATE, fd,
+                              static_cast<off_t>( map_begin ) );
+            if ( MAP_FAILED == map )
+            {
+                close( fd );
+                throw std::runtime_error( "Unable to map voxel file " +
+                                          _file_name );
+            }
+            const char* data = static_cast<const char*>( map );
+            for ( long r = first_row; r < last_row; ++r )
+            {
+                long j = voxel_min[Dim::J] + r % num_row_j;
+                long k = voxel_min[Dim::K] + r / num_row_j;
+                const char* value = data + ( row_begin( r ) - map_begin );
+                for ( long i = voxel_min[Dim::I]; i < voxel_max[Dim::I];
+                      ++i, value += value_size )
+                    copyVoxel( value, i, j, k, voxel_min, host_mask,
+                               occupied_min, occupied_max );
+            }
+            munmap( map, map_end - map_begin );
+
+            first_row = last_row;
+        }
+
+        close( fd );
+    }
+
+    // Classify one voxel and store it in the host mask.
+    template <class HostMask>
+    void copyVoxel( const char* value, const long i, const long j,
+                    const long k, const long voxel_min[3],
+                    const HostMask& host_mask, long occupied_min[3],
+                    long occupied_max[3] ) const
+    {
+        bool in;
+        if ( VoxelFileHeader::SIGNED_DISTANCE == _header.type )
+        {
+            float distance;
+            std::memcpy( &distance, value, sizeof( float ) );
+            in = distance < 0.0f;
+        }
+        else
+        {
+            in = ( 0 != *value );
+        }
+
+        host_mask( i - voxel_min[Dim::I], j - voxel_min[Dim::J],
+                   k - voxel_min[Dim::K] ) = in;
+        if ( in )
+        {
+            long index[3] = { i, j, k };
+            for ( int d = 0; d < 3; ++d )
+            {
+                occupied_min[d] = std::min( occupied_min[d], index[d] );
+                occupied_max[d] = std::max( occupied_max[d], index[d] );
+            }
+        }
+    }
+
+  private:
+    std::string _file_name;
+    VoxelFileHeader _header;
+};
+
+//---------------------------------------------------------------------------//
+
+} // end namespace ExaMPM
+
+#endif // EXAMPM_VOXELGEOMETRY_HPP
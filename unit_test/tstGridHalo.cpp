@@ -0,0 +1,182 @@
+#include <ExaMPM_Halo.hpp>
+
+#include <Cajita.hpp>
+
+#include <Kokkos_Core.hpp>
+
+#include <mpi.h>
+
+#include <array>
+#include <cstdio>
+
+//---------------------------------------------------------------------------//
+// Comparison of the GridHalo exchanges with the Cajita halo. The grid is
+// non-periodic in I and periodic in J and K. K is never partitioned so every
+// rank is its own periodic neighbor in K.
+//---------------------------------------------------------------------------//
+using exec_space = Kokkos::DefaultExecutionSpace;
+using memory_space = exec_space::memory_space;
+
+//---------------------------------------------------------------------------//
+// Fill two copies of an array with the same rank-dependent partial values.
+// The values are small integers so the sums are exact in any order.
+template <class ArrayType>
+void fillPartials( const ArrayType& a, const ArrayType& b, const int rank )
+{
+    auto host = Kokkos::create_mirror_view( a.view() );
+    for ( unsigned i = 0; i < host.extent( 0 ); ++i )
+        for ( unsigned j = 0; j < host.extent( 1 ); ++j )
+            for ( unsigned k = 0; k < host.extent( 2 ); ++k )
+                for ( unsigned c = 0; c < host.extent( 3 ); ++c )
+                    host( i, j, k, c ) =
+                        ( i + 3 * j + 5 * k + 7 * rank + 11 * c ) % 13;
+    Kokkos::deep_copy( a.view(), host );
+    Kokkos::deep_copy( b.view(), host );
+}
+
+// Count the entries of the ghosted range that differ.
+template <class ArrayType>
+long countDifferences( const ArrayType& a, const ArrayType& b )
+{
+    auto host_a =
+        Kokkos::create_mirror_view_and_copy( Kokkos::HostSpace(), a.view() );
+    auto host_b =
+        Kokkos::create_mirror_view_and_copy( Kokkos::HostSpace(), b.view() );
+    long count = 0;
+    for ( unsigned i = 0; i < host_a.extent( 0 ); ++i )
+        for ( unsigned j = 0; j < host_a.extent( 1 ); ++j )
+            for ( unsigned k = 0; k < host_a.extent( 2 ); ++k )
+                for ( unsigned c = 0; c < host_a.extent( 3 ); ++c )
+                    if ( host_a( i, j, k, c ) != host_b( i, j, k, c ) )
+                        ++count;
+    return count;
+}
+
+//---------------------------------------------------------------------------//
+int testGridHalo()
+{
+    int comm_rank;
+    MPI_Comm_rank( MPI_COMM_WORLD, &comm_rank );
+
+    // Partition I and J only.
+    int comm_size;
+    MPI_Comm_size( MPI_COMM_WORLD, &comm_size );
+    std::array<int, 3> ranks_per_dim = { 0, 0, 1 };
+    MPI_Dims_create( comm_size, 3, ranks_per_dim.data() );
+    Cajita::ManualPartitioner partitioner( ranks_per_dim );
+
+    int num_cell = 24;
+    int halo_width = 2;
+    auto global_mesh = Cajita::createUniformGlobalMesh(
+        std::array<double, 3>{ 0.0, 0.0, 0.0 },
+        std::array<double, 3>{ 1.0, 1.0, 1.0 },
+        std::array<int, 3>{ num_cell, num_cell, num_cell } );
+    auto global_grid = Cajita::createGlobalGrid(
+        MPI_COMM_WORLD, global_mesh, std::array<bool, 3>{ false, true, true },
+        partitioner );
+    auto local_grid = Cajita::createLocalGrid( global_grid, halo_width );
+
+    int failures = 0;
+    auto check = [&]( const char* name, const long differences ) {
+        long total;
+        MPI_Allreduce( &differences, &total, 1, MPI_LONG, MPI_SUM,
+                       MPI_COMM_WORLD );
+        if ( total > 0 )
+        {
+            if ( 0 == comm_rank )
+                std::printf( "FAIL: %s differs in %ld entries\n", name,
+                             total );
+            ++failures;
+        }
+    };
+
+    // Fused node scatter-gather of a vector and a scalar of another type
+    // against a Cajita scatter followed by a gather.
+    {
+        auto vector_layout =
+            Cajita::createArrayLayout( local_grid, 3, Cajita::Node() );
+        auto scalar_layout =
+            Cajita::createArrayLayout( local_grid, 1, Cajita::Node() );
+        auto fused_vector =
+            Cajita::createArray<double, memory_space>( "v", vector_layout );
+        auto fused_scalar =
+            Cajita::createArray<float, memory_space>( "s", scalar_layout );
+        auto cajita_vector =
+            Cajita::createArray<double, memory_space>( "v", vector_layout );
+        auto cajita_scalar =
+            Cajita::createArray<float, memory_space>( "s", scalar_layout );
+        fillPartials( *fused_vector, *cajita_vector, comm_rank );
+        fillPartials( *fused_scalar, *cajita_scalar, comm_rank );
+
+        ExaMPM::GridHalo<memory_space> grid_halo( *local_grid,
+                                                  Cajita::Node() );
+        if ( !grid_halo.fusable() )
+        {
+            if ( 0 == comm_rank )
+                std::printf( "FAIL: blocks too small for a fused exchange\n" );
+            return 1;
+        }
+        grid_halo.scatterGather( exec_space(), *fused_vector, *fused_scalar );
+
+        auto vector_halo = Cajita::createHalo<double, memory_space>(
+            *vector_layout, Cajita::FullHaloPattern() );
+        auto scalar_halo = Cajita::createHalo<float, memory_space>(
+            *scalar_layout, Cajita::FullHaloPattern() );
+        vector_halo->scatter( exec_space(), Cajita::ScatterReduce::Sum(),
+                              *cajita_vector );
+        scalar_halo->scatter( exec_space(), Cajita::ScatterReduce::Sum(),
+                              *cajita_scalar );
+        vector_halo->gather( exec_space(), *cajita_vector );
+        scalar_halo->gather( exec_space(), *cajita_scalar );
+
+        check( "node vector scatter-gather",
+               countDifferences( *fused_vector, *cajita_vector ) );
+        check( "node scalar scatter-gather",
+               countDifferences( *fused_scalar, *cajita_scalar ) );
+    }
+
+    // Cell scatter against a Cajita scatter.
+    {
+        auto layout =
+            Cajita::createArrayLayout( local_grid, 1, Cajita::Cell() );
+        auto grid_array =
+            Cajita::createArray<double, memory_space>( "c", layout );
+        auto cajita_array =
+            Cajita::createArray<double, memory_space>( "c", layout );
+        fillPartials( *grid_array, *cajita_array, comm_rank );
+
+        ExaMPM::GridHalo<memory_space> grid_halo( *local_grid,
+                                                  Cajita::Cell() );
+        grid_halo.scatter( exec_space(), *grid_array );
+
+        auto halo = Cajita::createHalo<double, memory_space>(
+            *layout, Cajita::FullHaloPattern() );
+        halo->scatter( exec_space(), Cajita::ScatterReduce::Sum(),
+                       *cajita_array );
+
+        check( "cell scatter", countDifferences( *grid_array, *cajita_array ) );
+    }
+
+    return failures;
+}
+
+//---------------------------------------------------------------------------//
+int main( int argc, char* argv[] )
+{
+    MPI_Init( &argc, &argv );
+    Kokkos::initialize( argc, argv );
+
+    int failures = testGridHalo();
+
+    int comm_rank;
+    MPI_Comm_rank( MPI_COMM_WORLD, &comm_rank );
+    if ( 0 == failures && 0 == comm_rank )
+        std::printf( "PASS\n" );
+
+    Kokkos::finalize();
+    MPI_Finalize();
+
+    return ( 0 == failures ) ? 0 : 1;
+}
+
+//---------------------------------------------------------------------------//
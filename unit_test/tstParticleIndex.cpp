@@ -0,0 +1,190 @@
+#include <ExaMPM_Mesh.hpp>
+#include <ExaMPM_ParticleInit.hpp>
+#include <ExaMPM_Types.hpp>
+
+#include <Cajita.hpp>
+
+#include <Kokkos_Core.hpp>
+
+#include <mpi.h>
+
+#include <array>
+#include <cstdio>
+
+//---------------------------------------------------------------------------//
+// Checks of the particle index type. Particle creation and particle loops
+// are checked with small counts in both index modes. With
+// ExaMPM_ENABLE_64BIT_PARTICLE_INDEX they are also checked with more than
+// INT_MAX particles on a single rank.
+//---------------------------------------------------------------------------//
+using exec_space = Kokkos::DefaultExecutionSpace;
+using memory_space = exec_space::memory_space;
+
+//---------------------------------------------------------------------------//
+// Particle list for initializeParticles that stores no particle data. Each
+// created index sets a bit so the test can check that every index in
+// [0,size) is written exactly once without allocating the particles.
+struct IndexCheckList
+{
+    using device_type = Kokkos::Device<exec_space, memory_space>;
+    using tuple_type = int;
+
+    void resize( const ExaMPM::ParticleIndex n )
+    {
+        _size = n;
+        _bits = Kokkos::View<unsigned*, memory_space>( "bits", n / 32 + 1 );
+        _errors = Kokkos::View<unsigned long long, memory_space>( "errors" );
+    }
+
+    ExaMPM::ParticleIndex size() const { return _size; }
+
+    // Out of range and repeated indices are errors.
+    KOKKOS_INLINE_FUNCTION
+    void setTuple( const ExaMPM::ParticleIndex p, const tuple_type& ) const
+    {
+        if ( p < 0 || p >= _size )
+        {
+            Kokkos::atomic_increment( &_errors() );
+            return;
+        }
+        unsigned bit = 1u << ( p % 32 );
+        if ( Kokkos::atomic_fetch_or( &_bits( p / 32 ), bit ) & bit )
+            Kokkos::atomic_increment( &_errors() );
+    }
+
+    ExaMPM::ParticleIndex _size = 0;
+    Kokkos::View<unsigned*, memory_space> _bits;
+    Kokkos::View<unsigned long long, memory_space> _errors;
+};
+
+// Create a particle at every candidate position.
+struct CreateAll
+{
+    KOKKOS_INLINE_FUNCTION
+    bool operator()( const double[3], int& ) const { return true; }
+};
+
+//---------------------------------------------------------------------------//
+// Every index of the created particles is written exactly once.
+int testInitializeParticles( const int num_cell, const int ppc_dim )
+{
+    Kokkos::Array<double, 6> box = { 0.0, 0.0, 0.0, 1.0, 1.0, 1.0 };
+    std::array<int, 3> global_num_cell = { num_cell, num_cell, num_cell };
+    // Periodic so the mesh is not padded and every owned cell is created.
+    std::array<bool, 3> periodic = { true, true, true };
+    Cajita::ManualPartitioner partitioner( { 1, 1, 1 } );
+    ExaMPM::Mesh<memory_space> mesh( box, global_num_cell, periodic,
+                                     partitioner, 1, 1, MPI_COMM_SELF );
+
+    IndexCheckList particles;
+    ExaMPM::initializeParticles( exec_space(), *( mesh.localGrid() ), ppc_dim,
+                                 CreateAll(), particles );
+
+    ExaMPM::ParticleIndex expected = static_cast<ExaMPM::ParticleIndex>(
+                                         num_cell * num_cell * num_cell ) *
+                                     ppc_dim * ppc_dim * ppc_dim;
+    int failures = 0;
+    if ( particles.size() != expected )
+    {
+        std::printf( "FAIL: created %lld particles, expected %lld\n",
+                     static_cast<long long>( particles.size() ),
+                     static_cast<long long>( expected ) );
+        return 1;
+    }
+
+    unsigned long long errors;
+    Kokkos::deep_copy( errors, particles._errors );
+    if ( errors > 0 )
+    {
+        std::printf( "FAIL: %llu out of range or repeated indices\n",
+                     errors );
+        ++failures;
+    }
+
+    // Every index was written.
+    auto bits = particles._bits;
+    ExaMPM::ParticleIndex missing = 0;
+    Kokkos::parallel_reduce(
+        "check_init_indices",
+        ExaMPM::ParticleRangePolicy<exec_space>( 0, expected ),
+        KOKKOS_LAMBDA( const ExaMPM::ParticleIndex p,
+                       ExaMPM::ParticleIndex& result ) {
+            if ( !( bits( p / 32 ) & ( 1u << ( p % 32 ) ) ) )
+                ++result;
+        },
+        missing );
+    if ( missing > 0 )
+    {
+        std::printf( "FAIL: %lld particle indices not written\n",
+                     static_cast<long long>( missing ) );
+        ++failures;
+    }
+
+    return failures;
+}
+
+//---------------------------------------------------------------------------//
+// A particle loop visits every index up to n.
+int testParticleLoop( const ExaMPM::ParticleIndex n )
+{
+    ExaMPM::ParticleIndex count = 0;
+    Kokkos::parallel_reduce(
+        "check_loop_count", ExaMPM::ParticleRangePolicy<exec_space>( 0, n ),
+        KOKKOS_LAMBDA( const ExaMPM::ParticleIndex,
+                       ExaMPM::ParticleIndex& result ) { ++result; },
+        count );
+
+    ExaMPM::ParticleIndex max_index = 0;
+    Kokkos::parallel_reduce(
+        "check_loop_max", ExaMPM::ParticleRangePolicy<exec_space>( 0, n ),
+        KOKKOS_LAMBDA( const ExaMPM::ParticleIndex p,
+                       ExaMPM::ParticleIndex& result ) {
+            if ( p > result )
+                result = p;
+        },
+        Kokkos::Max<ExaMPM::ParticleIndex>( max_index ) );
+
+    if ( count != n || max_index != n - 1 )
+    {
+        std::printf( "FAIL: loop visited %lld indices up to %lld, expected "
+                     "%lld up to %lld\n",
+                     static_cast<long long>( count ),
+                     static_cast<long long>( max_index ),
+                     static_cast<long long>( n ),
+                     static_cast<long long>( n - 1 ) );
+        return 1;
+    }
+    return 0;
+}
+
+//---------------------------------------------------------------------------//
+int main( int argc, char* argv[] )
+{
+    MPI_Init( &argc, &argv );
+    Kokkos::initialize( argc, argv );
+
+    int failures = 0;
+    failures += testParticleLoop( 1000003 );
+    failures += testInitializeParticles( 13, 4 );
+
+#ifdef ExaMPM_ENABLE_64BIT_PARTICLE_INDEX
+    static_assert( sizeof( ExaMPM::ParticleIndex ) == 8,
+                   "Expected 64-bit particle indices" );
+
+    // Indices past 2^31.
+    failures += testParticleLoop( ( ExaMPM::ParticleIndex( 1 ) << 31 ) + 5 );
+
+    // The cell offsets are scanned and totaled in 64 bits. 130^3 cells with
+    // 1000 particles each create 2,197,000,000 particles, more than INT_MAX.
+    failures += testInitializeParticles( 130, 10 );
+#endif
+    if ( 0 == failures )
+        std::printf( "PASS\n" );
+
+    Kokkos::finalize();
+    MPI_Finalize();
+
+    return ( 0 == failures ) ? 0 : 1;
+}
+
+//---------------------------------------------------------------------------//
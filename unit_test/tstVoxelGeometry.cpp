@@ -0,0 +1,200 @@
+#include <ExaMPM_Mesh.hpp>
+#include <ExaMPM_VoxelGeometry.hpp>
+
+#include <Cajita.hpp>
+
+#include <Kokkos_Core.hpp>
+
+#include <mpi.h>
+
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+//---------------------------------------------------------------------------//
+// Round trip of a voxel file. Rank 0 writes the file, every rank loads the
+// block covering its owned cells, and the mask is compared against the
+// source occupancy at every voxel center the rank owns.
+//---------------------------------------------------------------------------//
+using exec_space = Kokkos::DefaultExecutionSpace;
+using memory_space = exec_space::memory_space;
+
+// Source occupancy of a voxel.
+bool occupied( const long i, const long j, const long k )
+{
+    return 0 == ( i * 7 + j * 13 + k * 29 ) % 3;
+}
+
+//---------------------------------------------------------------------------//
+void writeVoxelFile( const std::string& file_name, const int type,
+                     const std::array<int, 3>& num_voxel,
+                     const double spacing )
+{
+    ExaMPM::VoxelFileHeader header;
+    std::memset( &header, 0, sizeof( header ) );
+    std::memcpy( header.magic, ExaMPM::VoxelFileHeader::expectedMagic(), 8 );
+    header.version = 1;
+    header.type = type;
+    for ( int d = 0; d < 3; ++d )
+    {
+        header.num_voxel[d] = num_voxel[d];
+        header.low_corner[d] = 0.0;
+    }
+    header.spacing = spacing;
+
+    std::ofstream file( file_name, std::ios::binary | std::ios::trunc );
+    file.write( reinterpret_cast<const char*>( &header ), sizeof( header ) );
+    for ( long k = 0; k < num_voxel[2]; ++k )
+        for ( long j = 0; j < num_voxel[1]; ++j )
+            for ( long i = 0; i < num_voxel[0]; ++i )
+            {
+                if ( ExaMPM::VoxelFileHeader::SIGNED_DISTANCE == type )
+                {
+                    float distance = occupied( i, j, k ) ? -1.0f : 1.0f;
+                    file.write( reinterpret_cast<const char*>( &distance ),
+                                sizeof( float ) );
+                }
+                else
+                {
+                    char value = occupied( i, j, k ) ? 1 : 0;
+                    file.write( &value, 1 );
+                }
+            }
+}
+
+//---------------------------------------------------------------------------//
+int testRoundTrip( const std::string& name, const int type,
+                   const std::array<int, 3>& num_voxel )
+{
+    int comm_rank, comm_size;
+    MPI_Comm_rank( MPI_COMM_WORLD, &comm_rank );
+    MPI_Comm_size( MPI_COMM_WORLD, &comm_size );
+
+    // The voxels cover [0,1] along I and start at the origin.
+    double spacing = 1.0 / num_voxel[0];
+    std::string file_name =
+        "tstVoxelGeometry_" + name + "_" + std::to_string( comm_size ) +
+        ".exavoxel";
+    if ( 0 == comm_rank )
+        writeVoxelFile( file_name, type, num_voxel, spacing );
+    MPI_Barrier( MPI_COMM_WORLD );
+
+    // Periodic so the mesh is not padded and the owned cells tile [0,1].
+    int num_cell = 12;
+    Kokkos::Array<double, 6> box = { 0.0, 0.0, 0.0, 1.0, 1.0, 1.0 };
+    std::array<int, 3> global_num_cell = { num_cell, num_cell, num_cell };
+    std::array<bool, 3> periodic = { true, true, true };
+    Cajita::DimBlockPartitioner<3> partitioner;
+    ExaMPM::Mesh<memory_space> mesh( box, global_num_cell, periodic,
+                                     partitioner, 1, 1, MPI_COMM_WORLD );
+    const auto& local_grid = *( mesh.localGrid() );
+
+    ExaMPM::VoxelGeometry geometry( file_name );
+    auto mask = geometry.load<Kokkos::HostSpace>( local_grid );
+
+    // Owned region of this rank.
+    auto owned_cells = local_grid.indexSpace( Cajita::Own(), Cajita::Cell(),
+                                              Cajita::Local() );
+    double cell_size = 1.0 / num_cell;
+    double owned_low[3];
+    double owned_high[3];
+    for ( int d = 0; d < 3; ++d )
+    {
+        owned_low[d] =
+            cell_size * local_grid.globalGrid().globalOffset( d );
+        owned_high[d] = owned_low[d] + cell_size * owned_cells.extent( d );
+    }
+
+    auto owns = [&]( const double x[3] ) {
+        for ( int d = 0; d < 3; ++d )
+            if ( x[d] < owned_low[d] || x[d] >= owned_high[d] )
+                return false;
+        return true;
+    };
+
+    // Compare every owned voxel center with the source.
+    long num_owned = 0;
+    long num_wrong = 0;
+    for ( long k = 0; k < num_voxel[2]; ++k )
+        for ( long j = 0; j < num_voxel[1]; ++j )
+            for ( long i = 0; i < num_voxel[0]; ++i )
+            {
+                double x[3] = { spacing * ( i + 0.5 ), spacing * ( j + 0.5 ),
+                                spacing * ( k + 0.5 ) };
+                if ( !owns( x ) )
+                    continue;
+                ++num_owned;
+                if ( mask.inside( x ) != occupied( i, j, k ) )
+                    ++num_wrong;
+            }
+
+    // Points past the end of the file are outside of the geometry.
+    double past[3] = { 0.5 * spacing, spacing * ( num_voxel[1] + 0.5 ),
+                       0.5 * spacing };
+    if ( owns( past ) && mask.inside( past ) )
+        ++num_wrong;
+
+    long local_counts[2] = { num_owned, num_wrong };
+    long global_counts[2];
+    MPI_Allreduce( local_counts, global_counts, 2, MPI_LONG, MPI_SUM,
+                   MPI_COMM_WORLD );
+
+    MPI_Barrier( MPI_COMM_WORLD );
+    if ( 0 == comm_rank )
+        std::remove( file_name.c_str() );
+
+    // Every voxel is owned by exactly one rank.
+    long num_total = static_cast<long>( num_voxel[0] ) * num_voxel[1] *
+                     num_voxel[2];
+    int failures = 0;
+    if ( global_counts[0] != num_total )
+    {
+        if ( 0 == comm_rank )
+            std::printf( "FAIL: %s checked %ld voxels, expected %ld\n",
+                         name.c_str(), global_counts[0], num_total );
+        ++failures;
+    }
+    if ( global_counts[1] > 0 )
+    {
+        if ( 0 == comm_rank )
+            std::printf( "FAIL: %s has %ld misclassified points\n",
+                         name.c_str(), global_counts[1] );
+        ++failures;
+    }
+    return failures;
+}
+
+//---------------------------------------------------------------------------//
+int main( int argc, char* argv[] )
+{
+    MPI_Init( &argc, &argv );
+    Kokkos::initialize( argc, argv );
+
+    int failures = 0;
+
+    // Signed distance cube aligned with the cells.
+    failures += testRoundTrip( "signed_distance",
+                               ExaMPM::VoxelFileHeader::SIGNED_DISTANCE,
+                               { 24, 24, 24 } );
+
+    // Occupancy slab with rows longer than a page so a block decomposed
+    // along I maps each of its rows separately.
+    failures += testRoundTrip( "occupancy",
+                               ExaMPM::VoxelFileHeader::OCCUPANCY,
+                               { 12288, 6, 6 } );
+
+    int comm_rank;
+    MPI_Comm_rank( MPI_COMM_WORLD, &comm_rank );
+    if ( 0 == failures && 0 == comm_rank )
+        std::printf( "PASS\n" );
+
+    Kokkos::finalize();
+    MPI_Finalize();
+
+    return ( 0 == failures ) ? 0 : 1;
+}
+
+//---------------------------------------------------------------------------//